@@ -1,31 +1,106 @@
 #include "lbuffer.h"
 #include "math.h"
 #include "lib/logs.h"
+#include "lbufferspan.h"
+#include "lbufferthreadpool.h"
+#include <string.h>
+#include <algorithm>
 
 
 const Vec2 LBuffer::vecAxis( 1.0f, 0.0f );
 
 
-LBuffer::LBuffer( int setSize, float setFloatSize )
-  :size( setSize ), buffer( new float[ setSize ] ), sizeToFloat( 1.0f / float( setSize ) ), fSize( float( setSize ) ), sizeFloat( setFloatSize ), invSizeFloat( 1.0f / setFloatSize ), lightRadius( 1000.0f )
+LBuffer::LBuffer( int setSize, float setFloatSize, LBufferStorage setStorage, void *setBuffer )
+  :size( setSize ), sizeFloat( setFloatSize ), invSizeFloat( 1.0f / setFloatSize ), sizeToFloat( 1.0f / float( setSize ) ), fSize( float( setSize ) ), columnsPerTurn( Math::TWO_PI * float( setSize ) / setFloatSize ), fullCircle( Math::Fabs( setFloatSize - Math::TWO_PI ) < Math::FLT_EPSILON_NUM * 8.0f ), sizeMask( ( setSize & ( setSize - 1 ) ) ? 0 : setSize - 1 ), sizeShift( Math::ILog2( setSize ) ), columnsPerTurnFixed( ( unsigned long long )( double( setSize ) * 6.28318530717958647692 / double( setFloatSize ) * 65536.0 + 0.5 ) ), storage( setStorage ), ownBuffer( !setBuffer ), windowBegin( 0 ), windowEnd( setSize ), lightRadius( 1000.0f ), frontToBack( false ), finalizing( false ), concurrent( false ), deferred( false ), dirtyStamp( 1 ), recordingObject( -1 ), rays( LBufferRayTable::Acquire( setSize, setFloatSize ) )
 {
+  if( setBuffer ) {
+    this->buffer = static_cast< float* >( setBuffer );
+  } else {
+    this->buffer = new float[ ( GetBufferBytes( setSize, setStorage ) + sizeof( float ) - 1 ) / sizeof( float ) ];
+  }
 }
 
 
 LBuffer::~LBuffer() {
-  delete [] this->buffer;
+  this->_ClearObjects();
+  if( this->ownBuffer ) {
+    delete [] this->buffer;
+  }
 }
 
 
+//    
+int LBuffer::GetBufferBytes( int size, LBufferStorage storage ) {
+  switch( storage ) {
+  case LBUFFER_STORAGE_HALF:
+  case LBUFFER_STORAGE_UINT16:
+    return size * int( sizeof( unsigned short ) );
+  case LBUFFER_STORAGE_UINT8_LOG:
+    return size;
+  default:
+    return size * int( sizeof( float ) );
+  }
+}//GetBufferBytes
+
+
 void LBuffer::Clear( float value ) {
-  for( int q = this->size; q; ) {
-    this->buffer[ --q ] = value;
+  if( value != this->lightRadius ) { //  ,    
+    this->cache.ClearCache();
   }
+  this->_ClearObjects();
   this->lightRadius = value;
+  const int begin = this->windowBegin;
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF:
+  case LBUFFER_STORAGE_UINT16: {
+    unsigned short code = ( this->storage == LBUFFER_STORAGE_HALF ? LBufferHalfEncoder().Encode( value ) : LBufferLinear16Encoder( value ).Encode( value ) );
+    for( int q = this->windowEnd; q > begin; ) {
+      this->buffer16[ --q ] = code;
+    }
+    break;
+  }
+  case LBUFFER_STORAGE_UINT8_LOG:
+    memset( this->buffer8 + begin, LBufferLog8Encoder( value ).Encode( value ), this->windowEnd - begin );
+    break;
+  default:
+    for( int q = this->windowEnd; q > begin; ) {
+      this->buffer[ --q ] = value;
+    }
+  }
+  if( !this->tileMax.empty() ) {
+    const float stored = this->_GetValueAt( begin ); //      value
+    for( int q = ( this->windowEnd + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT; q > ( begin >> LBUFFER_TILE_SHIFT ); ) {
+      this->tileMax[ --q ] = stored;
+    }
+  }
   this->cache.Update();
 }//Clear
 
 
+/*
+===========
+  SetColumnWindow
+       [ begin; end ),    .
+         ,     (. LBufferSet);
+            .
+===========
+*/
+void LBuffer::SetColumnWindow( int begin, int end ) {
+  begin = max( begin, 0 ) & ~( LBUFFER_TILE_SIZE - 1 );
+  end = min( ( end + LBUFFER_TILE_SIZE - 1 ) & ~( LBUFFER_TILE_SIZE - 1 ), this->size );
+  if( begin >= end ) {
+    begin = 0;
+    end = this->size;
+  }
+  if( begin != this->windowBegin || end != this->windowEnd ) {
+    this->windowBegin = begin;
+    this->windowEnd = end;
+    this->_UpdateTiles( begin, end );
+  }
+}//SetColumnWindow
+
+
+
 /*
 ===========
   DrawPolarLine
@@ -56,34 +131,97 @@ void LBuffer::DrawPolarLine( const Vec2& lineBegin, const Vec2& lineEnd ) {
   }
 
   if( xBegin == xEnd ) { // 
-    this->buffer[ xBegin ] = pointBegin.y;
+    if( xBegin >= this->windowBegin && xBegin < this->windowEnd ) {
+      this->_SetValueAt( xBegin, pointBegin.y );
+    }
     return;
   }
 
-  //begin
-  this->_PushValue( xBegin, pointBegin.y );
-  //middle
-  for( int x = xBegin + 1; x < xEnd; ++x ) {
-    float t = float( x - xBegin ) / float( xEnd - xBegin );
-    float value = pointBegin.y * ( 1.0f - t ) + pointEnd.y * t;
-    this->_PushValue( x, value );
+  LBufferLinearDepth generator;
+  generator.base = pointBegin.y;
+  generator.slope = ( pointEnd.y - pointBegin.y ) / float( xEnd - xBegin );
+  generator.origin = xBegin;
+  xBegin = max( xBegin, this->windowBegin );
+  xEnd = min( xEnd + 1, this->windowEnd );
+  if( xBegin < xEnd ) {
+    this->_WriteSpan( xBegin, xEnd, generator );
+    this->_UpdateTiles( xBegin, xEnd );
   }
-  //end
-  this->_PushValue( xEnd, pointEnd.y );
 }//DrawPolarLine
 
 
 
+/*
+===========
+  _WriteSpan
+          
+===========
+*/
+template< class Generator >
+int LBuffer::_WriteSpan( int begin, int end, const Generator &generator, LBufferCacheEntity::Value *out ) {
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF:
+    return LBufferWriteSpanEncoded( this->buffer16, begin, end, LBufferHalfEncoder(), generator, out );
+  case LBUFFER_STORAGE_UINT16:
+    return LBufferWriteSpanEncoded( this->buffer16, begin, end, LBufferLinear16Encoder( this->lightRadius ), generator, out );
+  case LBUFFER_STORAGE_UINT8_LOG:
+    return LBufferWriteSpanEncoded( this->buffer8, begin, end, LBufferLog8Encoder( this->lightRadius ), generator, out );
+  default:
+    if( this->concurrent ) {
+      return LBufferWriteSpanAtomic( this->buffer, begin, end, generator, out );
+    }
+    return LBufferWriteSpan( this->buffer, begin, end, generator, out );
+  }
+}//_WriteSpan
+
+
+
+float LBuffer::_GetValueAt( int index ) const {
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF:
+    return LBufferHalfEncoder().Decode( this->buffer16[ index ] );
+  case LBUFFER_STORAGE_UINT16:
+    return LBufferLinear16Encoder( this->lightRadius ).Decode( this->buffer16[ index ] );
+  case LBUFFER_STORAGE_UINT8_LOG:
+    return LBufferLog8Encoder( this->lightRadius ).Decode( this->buffer8[ index ] );
+  default:
+    return this->buffer[ index ];
+  }
+}//_GetValueAt
+
+
+
+void LBuffer::_SetValueAt( int index, float value ) {
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF:
+    this->buffer16[ index ] = LBufferHalfEncoder().Encode( value );
+    break;
+  case LBUFFER_STORAGE_UINT16:
+    this->buffer16[ index ] = LBufferLinear16Encoder( this->lightRadius ).Encode( value );
+    break;
+  case LBUFFER_STORAGE_UINT8_LOG:
+    this->buffer8[ index ] = LBufferLog8Encoder( this->lightRadius ).Encode( value );
+    break;
+  default:
+    this->buffer[ index ] = value;
+  }
+}//_SetValueAt
+
+
+
 void LBuffer::_PushValue( int position, float value, LBufferCacheEntity *cacheElement ) {
-  while( position < 0 ) {
-    position += this->size;
+  position = this->_WrapColumn( position );
+  if( position < this->windowBegin || position >= this->windowEnd ) {
+    return;
   }
-  position %= this->size;
   if( value < 0.0f ) {
     value = 0.0f;
   }
-  if( value < this->buffer[ position ] ) {
-    this->buffer[ position ] = value;
+  if( this->concurrent ) {
+    LBufferAtomicMin( this->buffer + position, value );
+  } else if( value < this->_GetValueAt( position ) ) {
+    this->_SetValueAt( position, value );
+    this->_UpdateTiles( position, position + 1 );
   }
   if( cacheElement ) {
     cacheElement->values.push_back( LBufferCacheEntity::Value( position, value ) );
@@ -92,12 +230,361 @@ void LBuffer::_PushValue( int position, float value, LBufferCacheEntity *cacheEl
 
 
 
+/*
+===========
+  _UpdateTiles
+     ,     [ begin; end )
+===========
+*/
+void LBuffer::_UpdateTiles( int begin, int end ) {
+  if( this->concurrent || this->tileMax.empty() ) { //  ,  ;   EndConcurrent
+    return;
+  }
+  for( int tile = begin >> LBUFFER_TILE_SHIFT, tileEnd = ( end + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT; tile < tileEnd; ++tile ) {
+    int x = tile << LBUFFER_TILE_SHIFT,
+        xEnd = min( x + LBUFFER_TILE_SIZE, this->size );
+    switch( this->storage ) {
+    case LBUFFER_STORAGE_HALF:
+    case LBUFFER_STORAGE_UINT16: { // :   -  
+      unsigned short code = 0;
+      for( ; x < xEnd; ++x ) {
+        code = max( code, this->buffer16[ x ] );
+      }
+      this->tileMax[ tile ] = ( this->storage == LBUFFER_STORAGE_HALF ? LBufferHalfEncoder().Decode( code ) : LBufferLinear16Encoder( this->lightRadius ).Decode( code ) );
+      break;
+    }
+    case LBUFFER_STORAGE_UINT8_LOG: {
+      unsigned char code = 0;
+      for( ; x < xEnd; ++x ) {
+        code = max( code, this->buffer8[ x ] );
+      }
+      this->tileMax[ tile ] = LBufferLog8Encoder( this->lightRadius ).Decode( code );
+      break;
+    }
+    default: {
+      __m128 value = _mm_setzero_ps();
+      for( ; x + 4 <= xEnd; x += 4 ) {
+        value = _mm_max_ps( value, _mm_loadu_ps( this->buffer + x ) );
+      }
+      value = _mm_max_ps( value, _mm_shuffle_ps( value, value, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+      value = _mm_max_ss( value, _mm_shuffle_ps( value, value, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+      float result = _mm_cvtss_f32( value );
+      for( ; x < xEnd; ++x ) {
+        result = max( result, this->buffer[ x ] );
+      }
+      this->tileMax[ tile ] = result;
+    }
+    }
+  }
+}//_UpdateTiles
+
+
+
+/*
+===========
+  _EnsureTileMax
+         : ,      ,
+    .     (BeginConcurrent, _BinBatch)
+===========
+*/
+void LBuffer::_EnsureTileMax() {
+  if( this->tileMax.empty() ) {
+    this->tileMax.resize( this->_GetTileCount() );
+    this->_UpdateTiles( this->windowBegin, this->windowEnd );
+  }
+}//_EnsureTileMax
+
+
+
+/*
+===========
+  _FinalizeTile
+    ,     depth:     
+         
+===========
+*/
+void LBuffer::_FinalizeTile( int tile, float depth ) {
+  const int xBegin = tile << LBUFFER_TILE_SHIFT,
+            xEnd = min( xBegin + LBUFFER_TILE_SIZE, this->size );
+  unsigned int bits = 0;
+  int x = xBegin;
+  if( this->storage == LBUFFER_STORAGE_FLOAT ) {
+    const __m128 value = _mm_set1_ps( depth );
+    for( ; x + 4 <= xEnd; x += 4 ) {
+      bits |= ( unsigned int ) _mm_movemask_ps( _mm_cmple_ps( _mm_loadu_ps( this->buffer + x ), value ) ) << ( x - xBegin );
+    }
+  }
+  for( ; x < xEnd; ++x ) {
+    if( this->_GetValueAt( x ) <= depth ) {
+      bits |= 1u << ( x - xBegin );
+    }
+  }
+  this->finalized[ tile ] |= bits;
+}//_FinalizeTile
+
+
+
 void LBuffer::WriteFromCache( LBufferCacheEntity *cacheEntity ) {
-  cacheEntity->WriteToBuffer( this->buffer );
+  if( !cacheEntity->values.empty() ) {
+    const LBufferCacheEntity::Value *values = &cacheEntity->values[ 0 ];
+    const int count = int( cacheEntity->values.size() );
+    this->_WriteValues( values, count );
+    //     ,       
+    int lastTile = -1;
+    for( int q = 0; q < count; ++q ) {
+      const int tile = values[ q ].index >> LBUFFER_TILE_SHIFT;
+      if( tile != lastTile ) {
+        this->_UpdateTiles( tile << LBUFFER_TILE_SHIFT, ( tile << LBUFFER_TILE_SHIFT ) + 1 );
+        lastTile = tile;
+      }
+    }
+  }
 }//WriteFromCache
 
 
 
+//  count        ,    
+void LBuffer::_WriteValues( const LBufferCacheEntity::Value *values, int count ) {
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF:
+    LBufferWriteValuesEncoded( this->buffer16, LBufferHalfEncoder(), values, count );
+    break;
+  case LBUFFER_STORAGE_UINT16:
+    LBufferWriteValuesEncoded( this->buffer16, LBufferLinear16Encoder( this->lightRadius ), values, count );
+    break;
+  case LBUFFER_STORAGE_UINT8_LOG:
+    LBufferWriteValuesEncoded( this->buffer8, LBufferLog8Encoder( this->lightRadius ), values, count );
+    break;
+  default:
+    if( this->concurrent ) {
+      for( int q = 0; q < count; ++q ) {
+        LBufferAtomicMin( this->buffer + values[ q ].index, values[ q ].value );
+      }
+    } else {
+      for( int q = 0; q < count; ++q ) {
+        if( this->buffer[ values[ q ].index ] > values[ q ].value ) {
+          this->buffer[ values[ q ].index ] = values[ q ].value;
+        }
+      }
+    }
+  }
+}//_WriteValues
+
+
+
+/*
+===========
+  BeginObject
+       (  ):   ,
+       Draw*( cache, ... )  EndObject.
+      , EndObject  RemoveObject       ,
+   UpdateObjects    ,        :
+       ,     .
+   UpdateObjects     ;      .
+  Clear   .
+===========
+*/
+LBufferCacheEntity* LBuffer::BeginObject( ILBufferProjectedObject *object ) {
+  this->EndObject();
+  if( this->tileObjects.empty() ) { //  -     
+    const int tileCount = this->_GetTileCount();
+    this->tileObjects.resize( tileCount );
+    this->tileDirty.assign( tileCount, 0 );
+    this->tileCursor.assign( tileCount, 0 );
+  }
+  int id;
+  auto found = this->objectIds.find( object );
+  if( found != this->objectIds.end() ) {
+    id = found->second;
+  } else {
+    if( this->freeObjects.empty() ) {
+      id = int( this->objects.size() );
+      this->objects.push_back( NULL );
+    } else {
+      id = this->freeObjects.back();
+      this->freeObjects.pop_back();
+    }
+    this->objects[ id ] = new LBufferObjectRecord();
+    this->objects[ id ]->entity.object = object;
+    this->objectIds[ object ] = id;
+  }
+  LBufferObjectRecord &record = *this->objects[ id ];
+  this->_MarkDirtyTiles( record.tiles );
+  this->_UnlinkObject( id );
+  record.entity.Reset( object->GetPosition(), object->GetSize() );
+  this->recordingObject = id;
+  return &record.entity;
+}//BeginObject
+
+
+
+/*
+===========
+  EndObject
+    :     ,      UpdateObjects
+===========
+*/
+void LBuffer::EndObject() {
+  if( this->recordingObject < 0 ) {
+    return;
+  }
+  const int id = this->recordingObject;
+  this->recordingObject = -1;
+  LBufferObjectRecord &record = *this->objects[ id ];
+  std::vector< LBufferCacheEntity::Value > &values = record.entity.values;
+  for( auto &value: values ) {
+    const int tile = value.index >> LBUFFER_TILE_SHIFT;
+    if( !this->tileCursor[ tile ]++ ) {
+      record.tiles.push_back( tile );
+    }
+  }
+  std::sort( record.tiles.begin(), record.tiles.end() );
+  const int tileCount = int( record.tiles.size() );
+  record.tileFirst.resize( tileCount + 1 );
+  record.tileFirst[ 0 ] = 0;
+  for( int q = 0; q < tileCount; ++q ) {
+    int &cursor = this->tileCursor[ record.tiles[ q ] ];
+    record.tileFirst[ q + 1 ] = record.tileFirst[ q ] + cursor;
+    cursor = record.tileFirst[ q ];
+  }
+  this->groupedValues.resize( values.size() );
+  for( auto &value: values ) {
+    this->groupedValues[ this->tileCursor[ value.index >> LBUFFER_TILE_SHIFT ]++ ] = value;
+  }
+  values.swap( this->groupedValues );
+  record.tileSlot.resize( tileCount );
+  for( int q = 0; q < tileCount; ++q ) {
+    this->tileCursor[ record.tiles[ q ] ] = 0;
+    LBufferObjectSlot slot;
+    slot.id = id;
+    slot.tile = q;
+    slot.nearest = LBUFFER_DEPTH_MISS;
+    for( int k = record.tileFirst[ q ]; k < record.tileFirst[ q + 1 ]; ++k ) {
+      slot.nearest = min( slot.nearest, values[ k ].value );
+    }
+    std::vector< LBufferObjectSlot > &list = this->tileObjects[ record.tiles[ q ] ];
+    record.tileSlot[ q ] = int( list.size() );
+    list.push_back( slot );
+  }
+  this->_MarkDirtyTiles( record.tiles );
+}//EndObject
+
+
+
+void LBuffer::RemoveObject( ILBufferProjectedObject *object ) {
+  this->EndObject();
+  auto found = this->objectIds.find( object );
+  if( found == this->objectIds.end() ) {
+    return;
+  }
+  const int id = found->second;
+  this->_MarkDirtyTiles( this->objects[ id ]->tiles );
+  this->_UnlinkObject( id );
+  delete this->objects[ id ];
+  this->objects[ id ] = NULL;
+  this->freeObjects.push_back( id );
+  this->objectIds.erase( found );
+}//RemoveObject
+
+
+
+/*
+===========
+  UpdateObjects
+   ,  EndObject  RemoveObject
+===========
+*/
+void LBuffer::UpdateObjects() {
+  this->EndObject();
+  if( !this->dirtyTiles.empty() ) {
+    this->_RebuildDirtyTiles();
+  }
+}//UpdateObjects
+
+
+
+void LBuffer::_MarkDirtyTiles( const std::vector< int >& tiles ) {
+  for( auto &tile: tiles ) {
+    if( this->tileDirty[ tile ] != this->dirtyStamp ) {
+      this->tileDirty[ tile ] = this->dirtyStamp;
+      this->dirtyTiles.push_back( tile );
+    }
+  }
+}//_MarkDirtyTiles
+
+
+
+//     :       
+void LBuffer::_UnlinkObject( int id ) {
+  LBufferObjectRecord &record = *this->objects[ id ];
+  for( int q = 0, count = int( record.tiles.size() ); q < count; ++q ) {
+    std::vector< LBufferObjectSlot > &list = this->tileObjects[ record.tiles[ q ] ];
+    const int slot = record.tileSlot[ q ];
+    list[ slot ] = list.back();
+    list.pop_back();
+    if( slot < int( list.size() ) ) {
+      this->objects[ list[ slot ].id ]->tileSlot[ list[ slot ].tile ] = slot;
+    }
+  }
+  record.tiles.clear();
+  record.tileFirst.clear();
+  record.tileSlot.clear();
+}//_UnlinkObject
+
+
+
+/*
+===========
+  _RebuildDirtyTiles
+           ,   .
+        ;        ,
+        
+===========
+*/
+void LBuffer::_RebuildDirtyTiles() {
+  this->_EnsureTileMax();
+  for( auto &tile: this->dirtyTiles ) {
+    const int xBegin = tile << LBUFFER_TILE_SHIFT;
+    for( int x = max( xBegin, this->windowBegin ), xEnd = min( xBegin + LBUFFER_TILE_SIZE, this->windowEnd ); x < xEnd; ++x ) {
+      this->_SetValueAt( x, this->lightRadius );
+    }
+    this->_UpdateTiles( xBegin, xBegin + 1 );
+    this->replaySlots = this->tileObjects[ tile ];
+    std::sort( this->replaySlots.begin(), this->replaySlots.end(), []( const LBufferObjectSlot& a, const LBufferObjectSlot& b ) {
+      return a.nearest < b.nearest;
+    } );
+    for( auto &slot: this->replaySlots ) {
+      if( !( slot.nearest < this->tileMax[ tile ] ) ) {
+        break;
+      }
+      const LBufferObjectRecord &record = *this->objects[ slot.id ];
+      this->_WriteValues( &record.entity.values[ record.tileFirst[ slot.tile ] ], record.tileFirst[ slot.tile + 1 ] - record.tileFirst[ slot.tile ] );
+      this->_UpdateTiles( xBegin, xBegin + 1 );
+    }
+  }
+  this->dirtyTiles.clear();
+  ++this->dirtyStamp;
+}//_RebuildDirtyTiles
+
+
+
+void LBuffer::_ClearObjects() {
+  for( auto &record: this->objects ) {
+    delete record;
+  }
+  this->objects.clear();
+  this->freeObjects.clear();
+  this->objectIds.clear();
+  for( auto &list: this->tileObjects ) {
+    list.clear();
+  }
+  this->dirtyTiles.clear();
+  ++this->dirtyStamp;
+  this->recordingObject = -1;
+}//_ClearObjects
+
+
+
 void LBuffer::ClearCache() {
   this->cache.ClearCache();
 }//ClearCache
@@ -110,6 +597,18 @@ void LBuffer::ClearCache( ILBufferProjectedObject *object ) {
 
 
 
+/*
+===========
+  IsObjectInRange
+        :  GetPosition,  | GetSize |
+===========
+*/
+bool LBuffer::IsObjectInRange( ILBufferProjectedObject *object ) const {
+  return object->GetPosition().Length() - object->GetSize().Length() < this->lightRadius;
+}//IsObjectInRange
+
+
+
 bool LBuffer::IsObjectCached( ILBufferProjectedObject *object, LBufferCacheEntity** outCache ) {
   return this->cache.CheckCache( object, object->GetPosition(), object->GetSize(), outCache );
 }//IsObjectCached
@@ -120,91 +619,940 @@ bool LBuffer::IsObjectCached( ILBufferProjectedObject *object, LBufferCacheEntit
 ===========
   DrawLine
    ,    
+    (cache == NULL)       : ,    
+      , .        
+    ,        .
 ===========
 */
 void LBuffer::DrawLine( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1 ) {
-  if( !cache ) {
-    //__log.PrintInfo( Filelevel_WARNING, "LBuffer::DrawLine => no cache" );
+  this->_DrawSegment( cache, point0, point1, this->_PointToPolar( point0 ), this->_PointToPolar( point1 ) );
+}//DrawLine
+
+
+
+/*
+===========
+  DrawPolyline
+     count :        
+===========
+*/
+void LBuffer::DrawPolyline( LBufferCacheEntity *cache, const Vec2 *points, int count ) {
+  if( count < 2 ) {
     return;
   }
-  Vec2
-    lineBegin( Vec2( this->GetDegreeOfPoint( point0 ), point0.LengthFast() ) ),
-    lineEnd( Vec2( this->GetDegreeOfPoint( point1 ), point1.LengthFast() ) );
-  Vec2 linearPointBegin, linearPointEnd;
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, count, polarLocal, polarHeap );
+  for( int q = 1; q < count; ++q ) {
+    this->_DrawSegment( cache, points[ q - 1 ], points[ q ], polar[ q - 1 ], polar[ q ] );
+  }
+}//DrawPolyline
 
-  Vec2  pointBegin,
-        pointEnd;
-  pointBegin = lineBegin;
-  pointEnd = lineEnd;
-  linearPointBegin = point0;
-  linearPointEnd = point1;
-  int swapCount = 0;
-  if( lineBegin.x > lineEnd.x ) {
-    Math::Swap( lineBegin, lineEnd );
-    ++swapCount;
-    Math::Swap( pointBegin, pointEnd );
-    Math::Swap( linearPointBegin, linearPointEnd );
+
+
+/*
+===========
+  DrawPolygon
+      count 
+===========
+*/
+void LBuffer::DrawPolygon( LBufferCacheEntity *cache, const Vec2 *points, int count ) {
+  if( count < 2 ) {
+    return;
   }
-  if( lineEnd.x - lineBegin.x > Math::PI ) {
-    lineBegin.x += Math::TWO_PI;
-    pointBegin.x += Math::TWO_PI;
-    Math::Swap( lineBegin, lineEnd );
-    ++swapCount;
-    Math::Swap( pointBegin, pointEnd );
-    Math::Swap( linearPointBegin, linearPointEnd );
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, count, polarLocal, polarHeap );
+  for( int q = 0, prev = count - 1; q < count; prev = q++ ) {
+    this->_DrawSegment( cache, points[ prev ], points[ q ], polar[ prev ], polar[ q ] );
   }
-  if( lineBegin.x > lineEnd.x ) {
-    Math::Swap( lineBegin, lineEnd );
-    ++swapCount;
+}//DrawPolygon
+
+
+
+/*
+===========
+  DrawPolygonOccluder
+        :   ,  
+     - ,   ,   ,   .
+             .
+===========
+*/
+void LBuffer::DrawPolygonOccluder( LBufferCacheEntity *cache, const Vec2 *points, int count ) {
+  if( count < 3 ) {
+    this->DrawPolygon( cache, points, count );
+    return;
+  }
+  //     (  +x,  )
+  float area = 0.0f;
+  bool inside = false;
+  for( int q = 0, prev = count - 1; q < count; prev = q++ ) {
+    const Vec2 &a = points[ prev ],
+               &b = points[ q ];
+    area += a.x * b.y - a.y * b.x;
+    if( ( a.y > 0.0f ) != ( b.y > 0.0f ) && a.x - ( b.x - a.x ) * a.y / ( b.y - a.y ) > 0.0f ) {
+      inside = !inside;
+    }
+  }
+  if( area == 0.0f ) {
+    this->DrawPolygon( cache, points, count );
+    return;
+  }
+  // a-b       ,   a x b    
+  const float facing = ( inside ? area : -area );
+
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, count, polarLocal, polarHeap );
+  for( int q = 0, prev = count - 1; q < count; prev = q++ ) {
+    const Vec2 &a = points[ prev ],
+               &b = points[ q ];
+    const float side = a.x * b.y - a.y * b.x;
+    if( side * facing > 0.0f || ( side == 0.0f && a * b < 0.0f ) ) {
+      this->_DrawSegment( cache, a, b, polar[ prev ], polar[ q ] );
+    }
+  }
+}//DrawPolygonOccluder
+
+
+
+/*
+===========
+  BeginConcurrent
+         ,   LBUFFER_STORAGE_FLOAT
+      BeginFrontToBack (  false    ).
+   EndConcurrent      DrawLine, DrawPolyline, DrawPolygon, DrawPolygonOccluder,
+  DrawSegments  WriteFromCache:    ,     
+    BeginConcurrent.  -  LBufferCacheEntity    (  IsObjectCached):
+              .
+  Clear, DrawPolarLine, SetColumnWindow        .
+===========
+*/
+bool LBuffer::BeginConcurrent() {
+  if( this->storage != LBUFFER_STORAGE_FLOAT || this->frontToBack ) {
+    return false;
+  }
+  this->_EnsureTileMax();
+  this->concurrent = true;
+  return true;
+}//BeginConcurrent
+
+
+
+/*
+===========
+  EndConcurrent
+     ( ,    ):    
+===========
+*/
+void LBuffer::EndConcurrent() {
+  if( !this->concurrent ) {
+    return;
+  }
+  this->concurrent = false;
+  this->_UpdateTiles( this->windowBegin, this->windowEnd );
+}//EndConcurrent
+
+
+
+/*
+===========
+  BeginFrontToBack
+     : ,   ,   EndFrontToBack
+===========
+*/
+void LBuffer::BeginFrontToBack() {
+  this->frontToBack = true;
+  this->queue.clear();
+}//BeginFrontToBack
+
+
+
+/*
+===========
+  EndFrontToBack
+         .
+  ,        ,   finalized    ;
+  ,    ,    .
+===========
+*/
+void LBuffer::EndFrontToBack() {
+  this->frontToBack = false;
+  this->finalizing = true;
+  this->finalized.assign( this->_GetTileCount(), 0 );
+  this->_EnsureTileMax();
+  this->_SortQueue();
+  for( auto &key: this->queueOrder ) {
+    const LBufferQueuedSegment &segment = this->queue[ size_t( key & 0xFFFFFFFF ) ];
+    this->_RasterizeSegment( NULL, segment.point0, segment.point1, segment.polar0, segment.polar1, this->_GetWindow() );
+  }
+  this->queue.clear();
+  this->finalizing = false;
+}//EndFrontToBack
+
+
+
+/*
+===========
+  _SortQueue
+       nearest:      32 .
+    float      .
+===========
+*/
+void LBuffer::_SortQueue() {
+  const size_t count = this->queue.size();
+  this->queueOrder.resize( count );
+  this->queueOrderTemp.resize( count );
+  for( size_t q = 0; q < count; ++q ) {
+    union {
+      float f;
+      unsigned int i;
+    } bits;
+    bits.f = this->queue[ q ].nearest;
+    this->queueOrder[ q ] = ( ( unsigned long long ) bits.i << 32 ) | q;
+  }
+  for( int shift = 32; shift < 64; shift += 8 ) {
+    size_t offsets[ 256 ] = { 0 };
+    for( size_t q = 0; q < count; ++q ) {
+      ++offsets[ ( this->queueOrder[ q ] >> shift ) & 0xFF ];
+    }
+    for( size_t digit = 0, sum = 0; digit < 256; ++digit ) {
+      const size_t digitCount = offsets[ digit ];
+      offsets[ digit ] = sum;
+      sum += digitCount;
+    }
+    for( size_t q = 0; q < count; ++q ) {
+      const unsigned long long key = this->queueOrder[ q ];
+      this->queueOrderTemp[ offsets[ ( key >> shift ) & 0xFF ]++ ] = key;
+    }
+    this->queueOrder.swap( this->queueOrderTemp );
+  }
+}//_SortQueue
+
+
+
+/*
+===========
+  DrawSegments
+     : points[ 2 * q ], points[ 2 * q + 1 ]
+===========
+*/
+void LBuffer::DrawSegments( LBufferCacheEntity *cache, const Vec2 *points, int segmentCount ) {
+  if( segmentCount < 1 ) {
+    return;
+  }
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, segmentCount * 2, polarLocal, polarHeap );
+  for( int q = 0; q < segmentCount * 2; q += 2 ) {
+    this->_DrawSegment( cache, points[ q ], points[ q + 1 ], polar[ q ], polar[ q + 1 ] );
+  }
+}//DrawSegments
+
+
+
+/*
+===========
+  DrawSegmentsParallel
+   ,  DrawSegments  ,   :       ,
+     ,    ,      .
+          ,     .
+    BeginFrontToBack    .
+===========
+*/
+void LBuffer::DrawSegmentsParallel( const Vec2 *points, int segmentCount, LBufferThreadPool *pool ) {
+  const int tiles = ( ( this->windowEnd + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT ) - ( this->windowBegin >> LBUFFER_TILE_SHIFT );
+  const int sectorCount = ( pool ? min( pool->GetThreadCount() * LBUFFER_SECTORS_PER_THREAD, tiles ) : 1 );
+  if( sectorCount < 2 || this->frontToBack || this->concurrent || this->deferred ) {
+    this->DrawSegments( NULL, points, segmentCount );
+    return;
+  }
+  if( segmentCount < 1 ) {
+    return;
+  }
+
+  //   
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, segmentCount * 2, polarLocal, polarHeap );
+  this->batch.resize( segmentCount );
+  int batchCount = 0;
+  for( int q = 0; q < segmentCount * 2; q += 2 ) {
+    if( this->_ClipSegment( points[ q ], points[ q + 1 ], polar[ q ], polar[ q + 1 ], this->batch[ batchCount ] ) ) {
+      ++batchCount;
+    }
+  }
+  this->batch.resize( batchCount );
+  this->_BinBatch( sectorCount );
+
+  pool->Run( sectorCount, [ this ]( int sector ) {
+    this->_RasterizeSector( sector );
+  } );
+  this->batch.clear();
+}//DrawSegmentsParallel
+
+
+
+/*
+===========
+  BeginFrame
+    :  Submit     Flush   
+   LBUFFER_BIN_TILES ,         L1,     .
+        :  200 000        65536
+   4194304  Flush     DrawLine  15-50%,     ,
+    ,           .  ,  
+       ,    ;   - DrawSegments
+   DrawSegmentsParallel   
+===========
+*/
+void LBuffer::BeginFrame() {
+  this->deferred = true;
+  this->submitted.clear();
+}//BeginFrame
+
+
+
+/*
+===========
+  Submit
+    :  BeginFrame -  ,  DrawLine( NULL, ... );   BeginFrontToBack
+     EndFrontToBack,  
+===========
+*/
+void LBuffer::Submit( const Vec2& point0, const Vec2& point1 ) {
+  if( !this->deferred || this->frontToBack || this->concurrent ) {
+    this->DrawLine( NULL, point0, point1 );
+    return;
+  }
+  this->submitted.push_back( point0 );
+  this->submitted.push_back( point1 );
+}//Submit
+
+
+
+/*
+===========
+  Flush
+           :
+            ,     
+     
+===========
+*/
+void LBuffer::Flush() {
+  this->deferred = false;
+  const int pointCount = int( this->submitted.size() );
+  if( !pointCount ) {
+    return;
+  }
+  LBufferPolarPoint polarLocal[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< LBufferPolarPoint > polarHeap;
+  const Vec2 *points = &this->submitted[ 0 ];
+  LBufferPolarPoint *polar = this->_PointsToPolar( points, pointCount, polarLocal, polarHeap );
+  this->batch.resize( pointCount / 2 );
+  int batchCount = 0;
+  for( int q = 0; q < pointCount; q += 2 ) {
+    if( this->_ClipSegment( points[ q ], points[ q + 1 ], polar[ q ], polar[ q + 1 ], this->batch[ batchCount ] ) ) {
+      ++batchCount;
+    }
+  }
+  this->batch.resize( batchCount );
+
+  const int tiles = ( ( this->windowEnd + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT ) - ( this->windowBegin >> LBUFFER_TILE_SHIFT );
+  const int sectorCount = max( 1, ( tiles + LBUFFER_BIN_TILES - 1 ) / LBUFFER_BIN_TILES );
+  this->_BinBatch( sectorCount );
+  for( int sector = 0; sector < sectorCount; ++sector ) {
+    this->_RasterizeSector( sector );
+  }
+  this->batch.clear();
+  this->submitted.clear();
+}//Flush
+
+
+
+/*
+===========
+  _BinBatch
+     sectorCount        batch   binned:
+      ,    ,     batch
+===========
+*/
+void LBuffer::_BinBatch( int sectorCount ) {
+  const int tileBegin = this->windowBegin >> LBUFFER_TILE_SHIFT,
+            tileEnd = ( this->windowEnd + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT;
+  const int batchCount = int( this->batch.size() );
+
+  //:      
+  this->_EnsureTileMax();
+  this->sectors.resize( sectorCount );
+  this->tileSector.resize( this->tileMax.size() );
+  for( int sector = 0; sector < sectorCount; ++sector ) {
+    const int first = tileBegin + ( tileEnd - tileBegin ) * sector / sectorCount,
+              last = tileBegin + ( tileEnd - tileBegin ) * ( sector + 1 ) / sectorCount;
+    this->sectors[ sector ].begin = max( first << LBUFFER_TILE_SHIFT, this->windowBegin );
+    this->sectors[ sector ].end = min( last << LBUFFER_TILE_SHIFT, this->windowEnd );
+    for( int tile = first; tile < last; ++tile ) {
+      this->tileSector[ tile ] = sector;
+    }
+  }
+
+  //   :   (  )    ,
+  //     binned,      
+  this->sectorOffsets.assign( sectorCount + 1, 0 );
+  this->segmentSectors.resize( size_t( batchCount ) * 2 );
+  LBufferSpanRange ranges[ LBUFFER_SPAN_RANGES_MAX ];
+  for( int q = 0; q < batchCount; ++q ) {
+    LBufferSpanRange *segmentSectors = &this->segmentSectors[ size_t( q ) * 2 ];
+    segmentSectors[ 0 ].begin = segmentSectors[ 1 ].begin = 0;
+    segmentSectors[ 0 ].end = segmentSectors[ 1 ].end = 0;
+    const int rangesCount = this->_GetSegmentSpan( this->batch[ q ], ranges );
+    int count = 0;
+    for( int r = 0; r < rangesCount; ++r ) {
+      const int begin = max( ranges[ r ].begin, this->windowBegin ),
+                end = min( ranges[ r ].end, this->windowEnd );
+      if( begin >= end ) {
+        continue;
+      }
+      int first = this->tileSector[ begin >> LBUFFER_TILE_SHIFT ];
+      const int last = this->tileSector[ ( end - 1 ) >> LBUFFER_TILE_SHIFT ] + 1;
+      if( count && first < segmentSectors[ count - 1 ].end ) { //   
+        first = segmentSectors[ count - 1 ].end;
+      }
+      if( first >= last ) {
+        continue;
+      }
+      if( count == 2 ) { //   (  ):   
+        segmentSectors[ 1 ].end = last;
+        continue;
+      }
+      segmentSectors[ count ].begin = first;
+      segmentSectors[ count ].end = last;
+      ++count;
+    }
+    for( int r = 0; r < count; ++r ) {
+      for( int sector = segmentSectors[ r ].begin; sector < segmentSectors[ r ].end; ++sector ) {
+        ++this->sectorOffsets[ sector + 1 ];
+      }
+    }
+  }
+  for( int sector = 0; sector < sectorCount; ++sector ) {
+    this->sectorOffsets[ sector + 1 ] += this->sectorOffsets[ sector ];
+  }
+  this->binned.resize( this->sectorOffsets[ sectorCount ] );
+  for( int q = 0; q < batchCount; ++q ) {
+    const LBufferSpanRange *segmentSectors = &this->segmentSectors[ size_t( q ) * 2 ];
+    for( int r = 0; r < 2; ++r ) {
+      for( int sector = segmentSectors[ r ].begin; sector < segmentSectors[ r ].end; ++sector ) {
+        this->binned[ this->sectorOffsets[ sector ]++ ] = this->batch[ q ];
+      }
+    }
+  }
+  for( int sector = sectorCount; sector; --sector ) { //       
+    this->sectorOffsets[ sector ] = this->sectorOffsets[ sector - 1 ];
+  }
+  this->sectorOffsets[ 0 ] = 0;
+}//_BinBatch
+
+
+
+//       
+void LBuffer::_RasterizeSector( int sector ) {
+  const LBufferSpanRange &window = this->sectors[ sector ];
+  for( int q = this->sectorOffsets[ sector ], end = this->sectorOffsets[ sector + 1 ]; q < end; ++q ) {
+    const LBufferQueuedSegment &segment = this->binned[ q ];
+    this->_RasterizeSegment( NULL, segment.point0, segment.point1, segment.polar0, segment.polar1, window );
+  }
+}//_RasterizeSector
+
+
+
+LBufferPolarPoint LBuffer::_PointToPolar( const Vec2& point ) {
+  LBufferPolarPoint polar;
+  polar.angle = LBufferPointToAngle( point.x, point.y );
+  polar.length = LBufferLength( point );
+  return polar;
+}//_PointToPolar
+
+
+
+LBufferPolarPoint* LBuffer::_PointsToPolar( const Vec2 *points, int count, LBufferPolarPoint *local, std::vector< LBufferPolarPoint >& heap ) {
+  LBufferPolarPoint *polar = local;
+  if( count > LBUFFER_POLYGON_LOCAL_VERTICES ) {
+    heap.resize( count );
+    polar = &heap[ 0 ];
+  }
+  int q = 0;
+  for( ; q + 4 <= count; q += 4 ) {
+    __m128 xy01 = _mm_loadu_ps( &points[ q ].x ),
+           xy23 = _mm_loadu_ps( &points[ q + 2 ].x );
+    __m128 x = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 2, 0, 2, 0 ) ),
+           y = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+    __m128 angle = _mm_castsi128_ps( LBufferPointToAngleSse( x, y ) );
+    __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ) );
+    _mm_storeu_ps( reinterpret_cast< float* >( polar + q ), _mm_unpacklo_ps( angle, length ) );
+    _mm_storeu_ps( reinterpret_cast< float* >( polar + q + 2 ), _mm_unpackhi_ps( angle, length ) );
+  }
+  for( ; q < count; ++q ) {
+    polar[ q ] = this->_PointToPolar( points[ q ] );
+  }
+  return polar;
+}//_PointsToPolar
+
+
+
+/*
+===========
+  _DrawSegment
+             
+===========
+*/
+void LBuffer::_DrawSegment( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1 ) {
+  LBufferQueuedSegment segment;
+  if( !this->_ClipSegment( point0, point1, polar0, polar1, segment ) ) {
+    return;
+  }
+  if( this->frontToBack && !cache ) {
+    this->queue.push_back( segment );
+    return;
+  }
+  if( !cache && !this->concurrent ) {
+    this->_EnsureTileMax();
+  }
+  this->_RasterizeSegment( cache, segment.point0, segment.point1, segment.polar0, segment.polar1, this->_GetWindow() );
+}//_DrawSegment
+
+
+
+/*
+===========
+  _ClipSegment
+       (false),     
+===========
+*/
+bool LBuffer::_ClipSegment( const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1, LBufferQueuedSegment& outSegment ) {
+  outSegment.point0 = point0;
+  outSegment.point1 = point1;
+  outSegment.polar0 = polar0;
+  outSegment.polar1 = polar1;
+  int clipped;
+  if( !LBufferClipSegment( outSegment.point0, outSegment.point1, this->lightRadius, outSegment.nearest, clipped ) ) {
+    return false;
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT0 ) {
+    outSegment.polar0 = this->_PointToPolar( outSegment.point0 );
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT1 ) {
+    outSegment.polar1 = this->_PointToPolar( outSegment.point1 );
+  }
+  return true;
+}//_ClipSegment
+
+
+
+/*
+===========
+  _RasterizeSegment
+        window (    )
+===========
+*/
+void LBuffer::_RasterizeSegment( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1, const LBufferSpanRange& window ) {
+  //        pi:   begin  end    ,
+  //     ,     
+  LBufferPolarPoint pointBegin( polar0 ),
+                    pointEnd( polar1 );
+  const float side = point0.x * point1.y - point0.y * point1.x;
+  if( side > 0.0f ) {
     Math::Swap( pointBegin, pointEnd );
-    Math::Swap( linearPointBegin, linearPointEnd );
+  } else if( side == 0.0f && point0 * point1 < 0.0f ) { //   
+    const int x0 = this->_WrapColumn( this->GetColumnOfAngle( pointBegin.angle ) ),
+              x1 = this->_WrapColumn( this->GetColumnOfAngle( pointEnd.angle ) );
+    if( x0 >= window.begin && x0 < window.end ) {
+      this->_PushValue( x0, 0.0f, cache );
+    }
+    if( x1 >= window.begin && x1 < window.end ) {
+      this->_PushValue( x1, 0.0f, cache );
+    }
+    return;
+  }
+  LBufferAngle arc = pointEnd.angle - pointBegin.angle;
+  if( arc > LBUFFER_ANGLE_HALF + LBUFFER_ANGLE_QUARTER ) { //  ,     - 
+    arc = 0;
+  }
+  long long fixedBegin = this->_AngleToColumnFixed( pointBegin.angle );
+  long long fixedEnd = fixedBegin + this->_AngleToColumnFixed( arc );
+
+  if( ( fixedBegin >> 32 ) == ( fixedEnd >> 32 ) ) { // :   
+    const int x = int( fixedBegin >> 32 );
+    if( this->fullCircle || x < this->size ) {
+      const int column = this->_WrapColumn( x );
+      if( column >= window.begin && column < window.end ) {
+        this->_PushValue( column, min( pointBegin.length, pointEnd.length ), cache );
+      }
+    }
+    return;
+  }
+
+  //  ,     ,    
+  const long long error = this->_AngleToColumnFixed( LBUFFER_ANGLE_MAX_ERROR_BINARY );
+  LBufferSpanRange ranges[ LBUFFER_SPAN_RANGES_MAX ];
+  int rangesCount = this->_SplitSpan( fixedBegin - error, fixedEnd + error, ranges );
+  if( window.begin > 0 || window.end < this->size ) {
+    int count = 0;
+    for( int q = 0; q < rangesCount; ++q ) {
+      const int begin = max( ranges[ q ].begin, window.begin ),
+                end = min( ranges[ q ].end, window.end );
+      if( begin < end ) {
+        ranges[ count ].begin = begin;
+        ranges[ count ].end = end;
+        ++count;
+      }
+    }
+    rangesCount = count;
   }
 
-  int xBegin = this->Round( this->FloatToSize( pointBegin.x + Math::TWO_PI ) ),
-        xEnd = this->Round( this->FloatToSize( pointEnd.x + Math::TWO_PI ) );
+  LBufferLineDepth generator;
+  generator.Setup( point0, point1, this->lightRadius, *this->rays );
 
-  if( xBegin == xEnd ) { // 
-    this->_PushValue( xBegin, pointBegin.y, cache );
+  if( !cache ) { //  :           
+    //  :      numerator -   ,    | point0 |
+    const float nearest = LBufferGetNearestDistance( point0, point1 - point0, generator.tMin, generator.tMax ) * ( 1.0f - LBUFFER_TILE_REJECT_EPSILON ) - LBufferLength( point0 ) * LBUFFER_TILE_REJECT_EPSILON;
+    if( this->finalizing ) { //     -  
+      bool hidden = true;
+      for( int q = 0; q < rangesCount && hidden; ++q ) {
+        for( int x = ranges[ q ].begin, xEnd; x < ranges[ q ].end; x = xEnd ) {
+          const int tile = x >> LBUFFER_TILE_SHIFT;
+          xEnd = min( ( tile + 1 ) << LBUFFER_TILE_SHIFT, ranges[ q ].end );
+          if( ~this->finalized[ tile ] & this->_GetTileBits( x, xEnd ) ) {
+            hidden = false;
+            break;
+          }
+        }
+      }
+      if( hidden ) {
+        return;
+      }
+    }
+    for( int q = 0; q < rangesCount; ++q ) {
+      for( int x = ranges[ q ].begin, xEnd; x < ranges[ q ].end; x = xEnd ) {
+        const int tile = x >> LBUFFER_TILE_SHIFT;
+        xEnd = min( ( tile + 1 ) << LBUFFER_TILE_SHIFT, ranges[ q ].end );
+        if( !( nearest < this->tileMax[ tile ] ) ) {
+          if( this->finalizing ) {
+            this->finalized[ tile ] = ~0u;
+          }
+          continue;
+        }
+        int begin = x,
+            end = xEnd;
+        if( this->finalizing ) { //    
+          unsigned int open = ~this->finalized[ tile ] & this->_GetTileBits( x, xEnd );
+          if( open ) {
+            this->_FinalizeTile( tile, nearest );
+            open &= ~this->finalized[ tile ];
+          }
+          if( !open ) {
+            continue;
+          }
+          const int tileBegin = tile << LBUFFER_TILE_SHIFT;
+          while( !( open & ( 1u << ( begin - tileBegin ) ) ) ) {
+            ++begin;
+          }
+          while( !( open & ( 1u << ( end - 1 - tileBegin ) ) ) ) {
+            --end;
+          }
+        }
+        this->_WriteSpan( begin, end, generator );
+        this->_UpdateTiles( begin, end );
+      }
+    }
     return;
   }
 
-  float value;
-  Vec2 intersectPoint;
-  xBegin += this->size - 2;
-  xEnd += this->size + 2;
-  int calculationStep = -1;
-  int x = xBegin;
-  LOGD("%d:%d\n", xBegin, xEnd);
-  while( calculationStep ) {
-    int xValue = x % this->size;
-    float a = this->SizeToFloat( xValue, 0.001f );
-    if( Vec2::TestIntersect(
-      Vec2Null,
-      Vec2( Math::Cos( a ) * this->lightRadius * 2.0f, -Math::Sin( a ) * this->lightRadius * 2.0f ),
-      linearPointBegin,
-      linearPointEnd,
-      &intersectPoint,
-      0.01f
-    ) ) {
-      value = intersectPoint.LengthFast();
-      this->_PushValue( xValue, value, cache );
-      if( calculationStep < 0 && x <= xBegin ) {
-        calculationStep = 1;
-        x = xBegin;
-      } else if( calculationStep > 0 && x >= xEnd ) {
-        break;
+  int count = 0;
+  for( int q = 0; q < rangesCount; ++q ) {
+    count += ranges[ q ].end - ranges[ q ].begin;
+  }
+  size_t cacheOffset = cache->values.size();
+  cache->values.resize( cacheOffset + count );
+  LBufferCacheEntity::Value *out = count ? &cache->values[ cacheOffset ] : NULL;
+  for( int q = 0; q < rangesCount; ++q ) {
+    out += this->_WriteSpan( ranges[ q ].begin, ranges[ q ].end, generator, out );
+    this->_UpdateTiles( ranges[ q ].begin, ranges[ q ].end );
+  }
+  cache->values.resize( count ? out - &cache->values[ 0 ] : cacheOffset );
+}//_RasterizeSegment
+
+
+/*
+===========
+  _GetSegmentSpan
+   ,     _RasterizeSegment   ,    
+===========
+*/
+int LBuffer::_GetSegmentSpan( const LBufferQueuedSegment& segment, LBufferSpanRange *ranges ) const {
+  const LBufferPolarPoint *pointBegin = &segment.polar0,
+                          *pointEnd = &segment.polar1;
+  const float side = segment.point0.x * segment.point1.y - segment.point0.y * segment.point1.x;
+  if( side > 0.0f ) {
+    Math::Swap( pointBegin, pointEnd );
+  } else if( side == 0.0f && segment.point0 * segment.point1 < 0.0f ) { //   :  
+    int count = 0;
+    for( int q = 0; q < 2; ++q ) {
+      const int x = this->_WrapColumn( this->GetColumnOfAngle( q ? pointEnd->angle : pointBegin->angle ) );
+      ranges[ count ].begin = x;
+      ranges[ count ].end = x + 1;
+      if( !count || ranges[ 0 ].begin != x ) {
+        ++count;
       }
-    } else {
-      if( calculationStep < 0 && x <= xBegin ) {
-        calculationStep = 1;
-        x = xBegin;
-      } else if( calculationStep > 0 && x >= xEnd ) {
-        break;
+    }
+    if( count == 2 && ranges[ 0 ].begin > ranges[ 1 ].begin ) {
+      Math::Swap( ranges[ 0 ], ranges[ 1 ] );
+    }
+    return count;
+  }
+  LBufferAngle arc = pointEnd->angle - pointBegin->angle;
+  if( arc > LBUFFER_ANGLE_HALF + LBUFFER_ANGLE_QUARTER ) {
+    arc = 0;
+  }
+  const long long fixedBegin = this->_AngleToColumnFixed( pointBegin->angle ),
+                  fixedEnd = fixedBegin + this->_AngleToColumnFixed( arc ),
+                  error = this->_AngleToColumnFixed( LBUFFER_ANGLE_MAX_ERROR_BINARY );
+  //   -   fixedBegin,      
+  return this->_SplitSpan( fixedBegin - error - ( 1LL << 32 ), fixedEnd + error, ranges );
+}//_GetSegmentSpan
+
+
+
+/*
+===========
+  _SplitSpan
+  ,      [ fixedBegin; fixedEnd ] (   32.32   ),
+        ;  sizeFloat <= 2pi    
+===========
+*/
+int LBuffer::_SplitSpan( long long fixedBegin, long long fixedEnd, LBufferSpanRange *ranges ) const {
+  const long long turn = ( long long ) this->columnsPerTurnFixed << 16;
+  const long long one = 1LL << 32;
+  int count = 0;
+  for( long long shift = turn; count < LBUFFER_SPAN_RANGES_MAX; shift -= turn ) {
+    long long low = fixedBegin - shift,
+              high = fixedEnd - shift;
+    if( high < 0 ) {
+      continue;
+    }
+    int begin = low > 0 ? int( ( low + one - 1 ) >> 32 ) : 0;
+    if( begin >= this->size ) {
+      break;
+    }
+    int end = int( high >> 32 ) + 1;
+    if( end > this->size ) {
+      end = this->size;
+    }
+    if( count && ranges[ count - 1 ].end > begin ) { //  
+      begin = ranges[ count - 1 ].end;
+    }
+    if( begin < end ) {
+      ranges[ count ].begin = begin;
+      ranges[ count ].end = end;
+      ++count;
+    }
+  }
+  return count;
+}//_SplitSpan
+
+
+/*
+===========
+  GetColumnsOfPoints
+       ,      (. LBufferPointToTurns)
+===========
+*/
+void LBuffer::GetColumnsOfPoints( const Vec2 *points, int count, float *outColumns ) const {
+  const __m128 scale = _mm_set1_ps( this->columnsPerTurn );
+  int q = 0;
+  for( ; q + 4 <= count; q += 4 ) {
+    __m128 xy01 = _mm_loadu_ps( &points[ q ].x ),
+           xy23 = _mm_loadu_ps( &points[ q + 2 ].x );
+    __m128 x = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 2, 0, 2, 0 ) ),
+           y = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+    _mm_storeu_ps( outColumns + q, _mm_mul_ps( LBufferPointToTurnsSse( x, y ), scale ) );
+  }
+  for( ; q < count; ++q ) {
+    outColumns[ q ] = this->GetColumnOfPoint( points[ q ] );
+  }
+}//GetColumnsOfPoints
+
+
+/*
+===========
+  _GatherValues
+    
+===========
+*/
+void LBuffer::_GatherValues( const int *indices, float *outValues ) const {
+  switch( this->storage ) {
+  case LBUFFER_STORAGE_HALF: {
+    LBufferHalfEncoder encoder;
+    for( int q = 0; q < 8; ++q ) {
+      outValues[ q ] = encoder.Decode( this->buffer16[ indices[ q ] ] );
+    }
+    break;
+  }
+  case LBUFFER_STORAGE_UINT16: {
+    LBufferLinear16Encoder encoder( this->lightRadius );
+    for( int q = 0; q < 8; ++q ) {
+      outValues[ q ] = encoder.Decode( this->buffer16[ indices[ q ] ] );
+    }
+    break;
+  }
+  case LBUFFER_STORAGE_UINT8_LOG: {
+    LBufferLog8Encoder encoder( this->lightRadius );
+    for( int q = 0; q < 8; ++q ) {
+      outValues[ q ] = encoder.Decode( this->buffer8[ indices[ q ] ] );
+    }
+    break;
+  }
+  default:
+#ifdef __AVX2__
+    _mm256_storeu_ps( outValues, _mm256_i32gather_ps( this->buffer, _mm256_loadu_si256( reinterpret_cast< const __m256i* >( indices ) ), 4 ) );
+#else
+    for( int q = 0; q < 8; ++q ) {
+      outValues[ q ] = this->buffer[ indices[ q ] ];
+    }
+#endif
+    break;
+  }
+}//_GatherValues
+
+
+
+/*
+===========
+  _GatherQueryBlock
+          (. GetColumnsOfPoints),    .
+      int( column ),   GetValue;         0,
+     .       0
+===========
+*/
+void LBuffer::_GatherQueryBlock( const Vec2 *points, bool interpolate, LBufferQueryBlock& outBlock ) const {
+  const __m128 scale = _mm_set1_ps( this->columnsPerTurn ),
+               sizeFloat = _mm_set1_ps( float( this->size ) );
+  const __m128i last = _mm_set1_epi32( this->size - 1 ),
+                one = _mm_set1_epi32( 1 );
+  int indices0[ 8 ], indices1[ 8 ];
+  __m128 valid[ 2 ];
+  for( int half = 0; half < 2; ++half ) {
+    const __m128 xy01 = _mm_loadu_ps( &points[ half * 4 ].x ),
+                 xy23 = _mm_loadu_ps( &points[ half * 4 + 2 ].x );
+    const __m128 x = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 2, 0, 2, 0 ) ),
+                 y = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+    _mm_storeu_ps( outBlock.distanceSquared + half * 4, _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ) );
+    const __m128 column = _mm_mul_ps( LBufferPointToTurnsSse( x, y ), scale );
+    valid[ half ] = this->fullCircle ? _mm_castsi128_ps( _mm_set1_epi32( -1 ) ) : _mm_cmplt_ps( column, sizeFloat );
+    __m128i index0 = _mm_cvttps_epi32( column );
+    __m128i over = _mm_cmpgt_epi32( index0, last ); //  size       
+    index0 = _mm_or_si128( _mm_and_si128( over, this->fullCircle ? last : _mm_setzero_si128() ), _mm_andnot_si128( over, index0 ) );
+    _mm_storeu_si128( reinterpret_cast< __m128i* >( indices0 + half * 4 ), index0 );
+    if( interpolate ) {
+      _mm_storeu_ps( outBlock.weight + half * 4, _mm_sub_ps( column, _mm_cvtepi32_ps( index0 ) ) );
+      __m128i index1 = _mm_add_epi32( index0, one );
+      over = _mm_cmpgt_epi32( index1, last );
+      index1 = _mm_or_si128( _mm_and_si128( over, this->fullCircle ? _mm_setzero_si128() : last ), _mm_andnot_si128( over, index1 ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( indices1 + half * 4 ), index1 );
+    }
+  }
+  this->_GatherValues( indices0, outBlock.depth0 );
+  if( interpolate ) {
+    this->_GatherValues( indices1, outBlock.depth1 );
+  }
+  if( !this->fullCircle ) {
+    for( int half = 0; half < 2; ++half ) {
+      _mm_storeu_ps( outBlock.depth0 + half * 4, _mm_and_ps( _mm_loadu_ps( outBlock.depth0 + half * 4 ), valid[ half ] ) );
+      if( interpolate ) {
+        _mm_storeu_ps( outBlock.depth1 + half * 4, _mm_and_ps( _mm_loadu_ps( outBlock.depth1 + half * 4 ), valid[ half ] ) );
       }
     }
-    x += calculationStep;
   }
-}//DrawLine
+}//_GatherQueryBlock
+
+
+
+/*
+===========
+  QueryVisibility
+           : outLit[ q ] = 1,       .
+   interpolate        
+===========
+*/
+void LBuffer::QueryVisibility( const Vec2 *points, int count, unsigned char *outLit, bool interpolate ) const {
+  LBufferQueryBlock block;
+  Vec2 tail[ 8 ];
+  for( int q = 0; q < count; q += 8 ) {
+    const int blockCount = min( count - q, 8 );
+    const Vec2 *blockPoints = points + q;
+    if( blockCount < 8 ) {
+      for( int k = 0; k < 8; ++k ) {
+        tail[ k ] = ( k < blockCount ? points[ q + k ] : Vec2( 0.0f, 0.0f ) );
+      }
+      blockPoints = tail;
+    }
+    this->_GatherQueryBlock( blockPoints, interpolate, block );
+    int mask = 0;
+    for( int half = 0; half < 2; ++half ) {
+      __m128 depth = _mm_loadu_ps( block.depth0 + half * 4 );
+      if( interpolate ) {
+        depth = _mm_add_ps( depth, _mm_mul_ps( _mm_sub_ps( _mm_loadu_ps( block.depth1 + half * 4 ), depth ), _mm_loadu_ps( block.weight + half * 4 ) ) );
+      }
+      mask |= _mm_movemask_ps( _mm_cmple_ps( _mm_loadu_ps( block.distanceSquared + half * 4 ), _mm_mul_ps( depth, depth ) ) ) << ( half * 4 );
+    }
+    for( int k = 0; k < blockCount; ++k ) {
+      outLit[ q + k ] = ( unsigned char ) ( ( mask >> k ) & 1 );
+    }
+  }
+}//QueryVisibility
+
+
+
+/*
+===========
+  QueryAttenuation
+      0.0 / 1.0;  interpolate        
+     ,         
+===========
+*/
+void LBuffer::QueryAttenuation( const Vec2 *points, int count, float *outLight, bool interpolate ) const {
+  LBufferQueryBlock block;
+  Vec2 tail[ 8 ];
+  float light[ 8 ];
+  const __m128 one = _mm_set1_ps( 1.0f );
+  for( int q = 0; q < count; q += 8 ) {
+    const int blockCount = min( count - q, 8 );
+    const Vec2 *blockPoints = points + q;
+    if( blockCount < 8 ) {
+      for( int k = 0; k < 8; ++k ) {
+        tail[ k ] = ( k < blockCount ? points[ q + k ] : Vec2( 0.0f, 0.0f ) );
+      }
+      blockPoints = tail;
+    }
+    this->_GatherQueryBlock( blockPoints, interpolate, block );
+    float *out = ( blockCount < 8 ? light : outLight + q );
+    for( int half = 0; half < 2; ++half ) {
+      const __m128 distanceSquared = _mm_loadu_ps( block.distanceSquared + half * 4 ),
+                   depth0 = _mm_loadu_ps( block.depth0 + half * 4 );
+      __m128 lit = _mm_and_ps( _mm_cmple_ps( distanceSquared, _mm_mul_ps( depth0, depth0 ) ), one );
+      if( interpolate ) {
+        const __m128 depth1 = _mm_loadu_ps( block.depth1 + half * 4 );
+        const __m128 lit1 = _mm_and_ps( _mm_cmple_ps( distanceSquared, _mm_mul_ps( depth1, depth1 ) ), one );
+        lit = _mm_add_ps( lit, _mm_mul_ps( _mm_sub_ps( lit1, lit ), _mm_loadu_ps( block.weight + half * 4 ) ) );
+      }
+      _mm_storeu_ps( out + half * 4, lit );
+    }
+    if( out == light ) {
+      for( int k = 0; k < blockCount; ++k ) {
+        outLight[ q + k ] = light[ k ];
+      }
+    }
+  }
+}//QueryAttenuation
 
 
 float LBuffer::GetDegreeOfPoint( const Vec2& point ) {
@@ -235,19 +1583,19 @@ float LBuffer::GetValue( float x ) {
   if( x < 0.0f || x > this->sizeFloat ) {
     return 0.0f;
   }
-  return this->buffer[ ( int ) this->FloatToSize( x ) ];
+  return this->_GetValueAt( ( int ) this->FloatToSize( x ) );
 }//GetValue
 
 
 float LBuffer::GetValueByIndex( int index ) {
   if( index < 0 || index >= this->size ) {
-    return this->buffer[ 0 ];
+    return this->_GetValueAt( 0 );
   }
-  return this->buffer[ index ];
+  return this->_GetValueAt( index );
 }//GetValueByIndex
 
 void LBuffer::__Dump() {
   for( int q = 0; q < this->size; ++q ) {
-    LOGD( "%d => %3.3f\n", q, this->buffer[ q ] );
+    LOGD( "%d => %3.3f\n", q, this->_GetValueAt( q ) );
   }
 }
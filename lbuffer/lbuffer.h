@@ -2,8 +2,82 @@
 #define __LBUFFER_H__
 
 
+#include <unordered_map>
 #include "lib/klib.h"
 #include "lbuffercache.h"
+#include "lbufferraytable.h"
+#include "lbufferangle.h"
+#include "lbufferstorage.h"
+
+
+const int LBUFFER_POLYGON_LOCAL_VERTICES = 64; //           
+
+
+const int LBUFFER_SPAN_RANGES_MAX = 8;
+
+
+// :     2^LBUFFER_TILE_SHIFT     
+const int LBUFFER_TILE_SHIFT = 5;
+const int LBUFFER_TILE_SIZE = 1 << LBUFFER_TILE_SHIFT;
+const float LBUFFER_TILE_REJECT_EPSILON = 1.0e-4f; //       
+
+
+const int LBUFFER_SECTORS_PER_THREAD = 4; //     DrawSegmentsParallel,   
+const int LBUFFER_BIN_TILES = 64;         //   Flush:  float     24 
+
+
+//    :    
+struct LBufferPolarPoint {
+  LBufferAngle angle;
+  float length;
+};
+
+
+//,        EndFrontToBack
+struct LBufferQueuedSegment {
+  Vec2 point0;
+  Vec2 point1;
+  LBufferPolarPoint polar0;
+  LBufferPolarPoint polar1;
+  float nearest; //      
+};
+
+
+//   [ begin; end )
+struct LBufferSpanRange {
+  int begin;
+  int end;
+};
+
+
+//   :  ,     ,   
+struct LBufferQueryBlock {
+  float distanceSquared[ 8 ];
+  float depth0[ 8 ];
+  float depth1[ 8 ];
+  float weight[ 8 ];
+};
+
+
+class LBufferThreadPool;
+class LBufferSoftShadow;
+
+
+//   :  ,    LBufferObjectRecord::tiles      
+struct LBufferObjectSlot {
+  int id;
+  int tile;
+  float nearest;
+};
+
+
+//  :   (  )  ,   
+struct LBufferObjectRecord {
+  LBufferCacheEntity entity;
+  std::vector< int > tiles;     // ,  
+  std::vector< int > tileFirst; //   tiles[ q ]  entity.values, tiles.size() + 1 
+  std::vector< int > tileSlot;  //    LBuffer::tileObjects  tiles[ q ]
+};
 
 
 class ILBufferProjectedObject {
@@ -16,12 +90,33 @@ public:
 class LBuffer
 {
 public:
-  LBuffer( int setSize, float setFloatSize = 1.0f );
+  LBuffer( int setSize, float setFloatSize = 1.0f, LBufferStorage setStorage = LBUFFER_STORAGE_FLOAT, void *setBuffer = NULL ); //setBuffer -     (GetBufferBytes ), NULL - 
+  static int GetBufferBytes( int size, LBufferStorage storage );
   virtual ~LBuffer();
   void Clear( float value );
+  void SetColumnWindow( int begin, int end );
   void DrawPolarLine( const Vec2& lineBegin, const Vec2& lineEnd );
+  bool IsObjectInRange( ILBufferProjectedObject *object ) const;
   bool IsObjectCached( ILBufferProjectedObject *object, LBufferCacheEntity** outCache );
   void DrawLine( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1 );
+  void DrawPolyline( LBufferCacheEntity *cache, const Vec2 *points, int count );
+  void DrawPolygon( LBufferCacheEntity *cache, const Vec2 *points, int count );
+  void DrawPolygonOccluder( LBufferCacheEntity *cache, const Vec2 *points, int count );
+  void DrawSegments( LBufferCacheEntity *cache, const Vec2 *points, int segmentCount );
+  void DrawSegmentsParallel( const Vec2 *points, int segmentCount, LBufferThreadPool *pool );
+  void BeginFrame(); //  :     DrawLine, . lbuffer.cpp
+  void Submit( const Vec2& point0, const Vec2& point1 );
+  void Flush();
+  bool BeginConcurrent();
+  void EndConcurrent();
+  inline bool IsConcurrent() const {
+    return this->concurrent;
+  }
+  void BeginFrontToBack();
+  void EndFrontToBack();
+  inline bool IsFrontToBack() const {
+    return this->frontToBack;
+  }
   inline float GetSizeToFloatCoefficient() const {
     return this->sizeToFloat;
   }
@@ -47,8 +142,33 @@ public:
   inline int GetSize() const {
     return this->size;
   }
+  inline LBufferStorage GetStorage() const {
+    return this->storage;
+  }
+  inline float GetLightRadius() const { //  Clear:    
+    return this->lightRadius;
+  }
   float GetDegreeOfPoint( const Vec2& point );
+  inline float GetColumnOfPoint( const Vec2& point ) const {
+    return LBufferPointToTurns( point.x, point.y ) * this->columnsPerTurn;
+  }
+  void GetColumnsOfPoints( const Vec2 *points, int count, float *outColumns ) const;
+  void QueryVisibility( const Vec2 *points, int count, unsigned char *outLit, bool interpolate = false ) const;
+  void QueryAttenuation( const Vec2 *points, int count, float *outLight, bool interpolate = false ) const;
+  inline float GetColumnsPerTurn() const {
+    return this->columnsPerTurn;
+  }
+  inline int GetColumnOfAngle( LBufferAngle angle ) const {
+    return int( this->_AngleToColumnFixed( angle ) >> 32 );
+  }
   void WriteFromCache( LBufferCacheEntity *cacheEntity );
+  LBufferCacheEntity* BeginObject( ILBufferProjectedObject *object );
+  void EndObject();
+  void RemoveObject( ILBufferProjectedObject *object );
+  void UpdateObjects();
+  inline int GetObjectCount() const {
+    return int( this->objectIds.size() );
+  }
   void ClearCache();
   void ClearCache( ILBufferProjectedObject *object );
   void __Dump();
@@ -57,15 +177,110 @@ private:
   LBuffer();
   LBuffer( const LBuffer& );
   LBuffer& operator=( const LBuffer& );
+  friend class LBufferSoftShadow;
   void _PushValue( int position, float value, LBufferCacheEntity *cacheElement = NULL );
+  void _UpdateTiles( int begin, int end );
+  void _EnsureTileMax();
+  inline int _GetTileCount() const {
+    return ( this->size + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT;
+  }
+  void _FinalizeTile( int tile, float depth );
+  void _SortQueue();
+  //  [ begin; end )    (LBUFFER_TILE_SIZE   unsigned int)
+  inline unsigned int _GetTileBits( int begin, int end ) const {
+    const int count = end - begin;
+    return ( count >= LBUFFER_TILE_SIZE ? ~0u : ( 1u << count ) - 1u ) << ( begin & ( LBUFFER_TILE_SIZE - 1 ) );
+  }
+  float _GetValueAt( int index ) const;
+  void _GatherValues( const int *indices, float *outValues ) const;
+  void _GatherQueryBlock( const Vec2 *points, bool interpolate, LBufferQueryBlock& outBlock ) const;
+  void _SetValueAt( int index, float value );
+  template< class Generator >
+  int _WriteSpan( int begin, int end, const Generator &generator, LBufferCacheEntity::Value *out = NULL );
+  void _DrawSegment( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1 );
+  bool _ClipSegment( const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1, LBufferQueuedSegment& outSegment );
+  void _RasterizeSegment( LBufferCacheEntity *cache, const Vec2& point0, const Vec2& point1, const LBufferPolarPoint& polar0, const LBufferPolarPoint& polar1, const LBufferSpanRange& window );
+  int _GetSegmentSpan( const LBufferQueuedSegment& segment, LBufferSpanRange *ranges ) const;
+  void _BinBatch( int sectorCount );
+  void _RasterizeSector( int sector );
+  void _WriteValues( const LBufferCacheEntity::Value *values, int count );
+  void _MarkDirtyTiles( const std::vector< int >& tiles );
+  void _UnlinkObject( int id );
+  void _RebuildDirtyTiles();
+  void _ClearObjects();
+  LBufferPolarPoint _PointToPolar( const Vec2& point );
+  LBufferPolarPoint* _PointsToPolar( const Vec2 *points, int count, LBufferPolarPoint *local, std::vector< LBufferPolarPoint >& heap );
+  int _SplitSpan( long long fixedBegin, long long fixedEnd, LBufferSpanRange *ranges ) const;
+  inline int _WrapColumn( int position ) const {
+    if( this->sizeMask ) {
+      return position & this->sizeMask;
+    }
+    position %= this->size;
+    return position < 0 ? position + this->size : position;
+  }
+  inline LBufferSpanRange _GetWindow() const {
+    LBufferSpanRange window;
+    window.begin = this->windowBegin;
+    window.end = this->windowEnd;
+    return window;
+  }
+  //   ,  32.32;    16- ,  
+  //  64   columnsPerTurn  65536
+  inline long long _AngleToColumnFixed( LBufferAngle angle ) const {
+    if( this->fullCircle && this->sizeMask ) {
+      return ( long long ) angle << this->sizeShift;
+    }
+    return ( long long ) ( ( unsigned long long ) ( angle >> 16 ) * this->columnsPerTurnFixed + ( ( ( unsigned long long ) ( angle & 0xFFFFu ) * this->columnsPerTurnFixed ) >> 16 ) );
+  }
 
   const int size;
   const float sizeFloat;
   const float invSizeFloat;
   const float sizeToFloat;
   const float fSize;
-  float *buffer;
+  const float columnsPerTurn; //    , 2pi * size / sizeFloat
+  const bool fullCircle;      //   : sizeFloat == 2pi
+  const int sizeMask;         //size - 1  size -  ,  0
+  const int sizeShift;
+  const unsigned long long columnsPerTurnFixed; //columnsPerTurn   48.16
+  const LBufferStorage storage;
+  union { //    storage
+    float *buffer;
+    unsigned short *buffer16;
+    unsigned char *buffer8;
+  };
+  bool ownBuffer;
+  int windowBegin;  //  [ windowBegin; windowEnd ),    Clear  
+  int windowEnd;
   float lightRadius;
+  std::vector< float > tileMax; //     LBUFFER_TILE_SIZE ,    ;      
+  bool frontToBack;             //     EndFrontToBack
+  bool finalizing;              //    ,  finalized
+  std::vector< LBufferQueuedSegment > queue;
+  std::vector< unsigned long long > queueOrder; // :  nearest   ,   
+  std::vector< unsigned long long > queueOrderTemp;
+  std::vector< unsigned int > finalized; //   ,   :         ;   EndFrontToBack
+  bool concurrent;              //    :  ,    
+  bool deferred;                // Submit   Flush
+  std::vector< Vec2 > submitted;              //  Submit
+  std::vector< LBufferQueuedSegment > batch;  // DrawSegmentsParallel  Flush,    
+  std::vector< LBufferSpanRange > sectors;    //    
+  std::vector< int > tileSector;              //   
+  std::vector< int > sectorOffsets;           //    binned, sectors.size() + 1 
+  std::vector< LBufferSpanRange > segmentSectors; //       batch
+  std::vector< LBufferQueuedSegment > binned; //  batch,   
+  std::vector< LBufferObjectRecord* > objects;   //  , NULL -  
+  std::vector< int > freeObjects;
+  std::unordered_map< void*, int > objectIds;
+  std::vector< std::vector< LBufferObjectSlot > > tileObjects; //,  ; tileObjects, tileDirty  tileCursor    BeginObject
+  std::vector< unsigned int > tileDirty;         // ,    dirtyStamp
+  std::vector< int > dirtyTiles;
+  std::vector< int > tileCursor;                 //    ,  EndObject 
+  std::vector< LBufferCacheEntity::Value > groupedValues;
+  std::vector< LBufferObjectSlot > replaySlots;
+  unsigned int dirtyStamp;
+  int recordingObject;                           //  BeginObject  EndObject, -1 - 
+  std::shared_ptr< const LBufferRayTable > rays;
   static const Vec2 vecAxis;
   LBufferCache cache;
 };
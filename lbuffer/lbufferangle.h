@@ -0,0 +1,139 @@
+#ifndef __LBUFFERANGLE_H__
+#define __LBUFFERANGLE_H__
+
+
+#include <emmintrin.h>
+
+
+/*
+      atan2  .
+     ,     (   a   ( cos a, -sin a )),
+      [ 0; 1 ): 0 -  +x, 0.25 -  -y.
+  atan      11- ,    ,
+    0/1    eps.
+          LBufferAngle.
+   : LBUFFER_ANGLE_MAX_ERROR  (~2.2e-6 , ~1500   ),
+  .. LBUFFER_ANGLE_MAX_ERROR * columnsPerTurn  (0.02   65536   ).
+*/
+const float LBUFFER_ANGLE_MAX_ERROR = 3.5e-7f;
+
+const float LBUFFER_ANGLE_C0 =  0.99997726f / 6.28318530717958647692f;
+const float LBUFFER_ANGLE_C1 = -0.33262347f / 6.28318530717958647692f;
+const float LBUFFER_ANGLE_C2 =  0.19354346f / 6.28318530717958647692f;
+const float LBUFFER_ANGLE_C3 = -0.11643287f / 6.28318530717958647692f;
+const float LBUFFER_ANGLE_C4 =  0.05265332f / 6.28318530717958647692f;
+const float LBUFFER_ANGLE_C5 = -0.01172120f / 6.28318530717958647692f;
+
+
+// :   - 2^32,      0  
+typedef unsigned int LBufferAngle;
+
+const LBufferAngle LBUFFER_ANGLE_QUARTER = 0x40000000u;
+const LBufferAngle LBUFFER_ANGLE_HALF = 0x80000000u;
+const float LBUFFER_ANGLE_TURN = 4294967296.0f;
+const LBufferAngle LBUFFER_ANGLE_MAX_ERROR_BINARY = 1536u; //LBUFFER_ANGLE_MAX_ERROR        
+
+
+//atan( z ) / 2pi  z  [ 0; 1 ], ..      [ 0; 0.125 ]
+inline float LBufferOctantTurns( float z ) {
+  float z2 = z * z;
+  return z * ( LBUFFER_ANGLE_C0 + z2 * ( LBUFFER_ANGLE_C1 + z2 * ( LBUFFER_ANGLE_C2 + z2 * ( LBUFFER_ANGLE_C3 + z2 * ( LBUFFER_ANGLE_C4 + z2 * LBUFFER_ANGLE_C5 ) ) ) ) );
+}//LBufferOctantTurns
+
+
+inline __m128 LBufferOctantTurnsSse( __m128 z ) {
+  __m128 z2 = _mm_mul_ps( z, z );
+  __m128 a = _mm_add_ps( _mm_set1_ps( LBUFFER_ANGLE_C4 ), _mm_mul_ps( z2, _mm_set1_ps( LBUFFER_ANGLE_C5 ) ) );
+  a = _mm_add_ps( _mm_set1_ps( LBUFFER_ANGLE_C3 ), _mm_mul_ps( z2, a ) );
+  a = _mm_add_ps( _mm_set1_ps( LBUFFER_ANGLE_C2 ), _mm_mul_ps( z2, a ) );
+  a = _mm_add_ps( _mm_set1_ps( LBUFFER_ANGLE_C1 ), _mm_mul_ps( z2, a ) );
+  a = _mm_add_ps( _mm_set1_ps( LBUFFER_ANGLE_C0 ), _mm_mul_ps( z2, a ) );
+  return _mm_mul_ps( z, a );
+}//LBufferOctantTurnsSse
+
+
+inline float LBufferPointToTurns( float x, float y ) {
+  float ax = x < 0.0f ? -x : x,
+        ay = y < 0.0f ? -y : y;
+  bool steep = ay > ax;
+  float a = LBufferOctantTurns( steep ? ax / ay : ( ax > 0.0f ? ay / ax : 0.0f ) );
+  if( steep ) {
+    a = 0.25f - a;
+  }
+  if( x < 0.0f ) {
+    a = 0.5f - a;
+  }
+  if( y > 0.0f ) {
+    a = 1.0f - a;
+    if( a >= 1.0f ) {
+      a = 0.0f;
+    }
+  }
+  return a;
+}//LBufferPointToTurns
+
+
+//     
+inline __m128 LBufferPointToTurnsSse( __m128 x, __m128 y ) {
+  const __m128 signMask = _mm_set1_ps( -0.0f ), zero = _mm_setzero_ps(), one = _mm_set1_ps( 1.0f );
+  __m128 ax = _mm_andnot_ps( signMask, x ),
+         ay = _mm_andnot_ps( signMask, y );
+  __m128 steep = _mm_cmpgt_ps( ay, ax );
+  __m128 numerator = _mm_min_ps( ax, ay ),
+         denominator = _mm_max_ps( ax, ay );
+  __m128 a = LBufferOctantTurnsSse( _mm_and_ps( _mm_div_ps( numerator, denominator ), _mm_cmpgt_ps( denominator, zero ) ) );
+  __m128 reflected = _mm_sub_ps( _mm_set1_ps( 0.25f ), a );
+  a = _mm_or_ps( _mm_and_ps( steep, reflected ), _mm_andnot_ps( steep, a ) );
+  __m128 negativeX = _mm_cmplt_ps( x, zero );
+  reflected = _mm_sub_ps( _mm_set1_ps( 0.5f ), a );
+  a = _mm_or_ps( _mm_and_ps( negativeX, reflected ), _mm_andnot_ps( negativeX, a ) );
+  __m128 positiveY = _mm_cmpgt_ps( y, zero );
+  reflected = _mm_sub_ps( one, a );
+  reflected = _mm_and_ps( reflected, _mm_cmplt_ps( reflected, one ) );
+  return _mm_or_ps( _mm_and_ps( positiveY, reflected ), _mm_andnot_ps( positiveY, a ) );
+}//LBufferPointToTurnsSse
+
+
+/*
+    :     ,     
+        2^32,   0/2pi   .
+*/
+inline LBufferAngle LBufferPointToAngle( float x, float y ) {
+  float ax = x < 0.0f ? -x : x,
+        ay = y < 0.0f ? -y : y;
+  bool steep = ay > ax;
+  LBufferAngle a = LBufferAngle( int( LBufferOctantTurns( steep ? ax / ay : ( ax > 0.0f ? ay / ax : 0.0f ) ) * LBUFFER_ANGLE_TURN ) );
+  if( steep ) {
+    a = LBUFFER_ANGLE_QUARTER - a;
+  }
+  if( x < 0.0f ) {
+    a = LBUFFER_ANGLE_HALF - a;
+  }
+  if( y > 0.0f ) {
+    a = 0u - a;
+  }
+  return a;
+}//LBufferPointToAngle
+
+
+inline __m128i LBufferPointToAngleSse( __m128 x, __m128 y ) {
+  const __m128 signMask = _mm_set1_ps( -0.0f ), zero = _mm_setzero_ps();
+  __m128 ax = _mm_andnot_ps( signMask, x ),
+         ay = _mm_andnot_ps( signMask, y );
+  __m128i steep = _mm_castps_si128( _mm_cmpgt_ps( ay, ax ) );
+  __m128 numerator = _mm_min_ps( ax, ay ),
+         denominator = _mm_max_ps( ax, ay );
+  __m128 turns = LBufferOctantTurnsSse( _mm_and_ps( _mm_div_ps( numerator, denominator ), _mm_cmpgt_ps( denominator, zero ) ) );
+  __m128i a = _mm_cvttps_epi32( _mm_mul_ps( turns, _mm_set1_ps( LBUFFER_ANGLE_TURN ) ) );
+  __m128i reflected = _mm_sub_epi32( _mm_set1_epi32( int( LBUFFER_ANGLE_QUARTER ) ), a );
+  a = _mm_or_si128( _mm_and_si128( steep, reflected ), _mm_andnot_si128( steep, a ) );
+  __m128i negativeX = _mm_castps_si128( _mm_cmplt_ps( x, zero ) );
+  reflected = _mm_sub_epi32( _mm_set1_epi32( int( LBUFFER_ANGLE_HALF ) ), a );
+  a = _mm_or_si128( _mm_and_si128( negativeX, reflected ), _mm_andnot_si128( negativeX, a ) );
+  __m128i positiveY = _mm_castps_si128( _mm_cmpgt_ps( y, zero ) );
+  reflected = _mm_sub_epi32( _mm_setzero_si128(), a );
+  return _mm_or_si128( _mm_and_si128( positiveY, reflected ), _mm_andnot_si128( positiveY, a ) );
+}//LBufferPointToAngleSse
+
+
+#endif
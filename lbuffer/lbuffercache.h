@@ -17,6 +17,8 @@ public:
     int index;
     float value;
 
+    Value() {
+    }
     Value( int setIndex, float setValue )
     :index( setIndex ), value( setValue ) {
     }
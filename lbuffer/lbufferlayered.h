@@ -0,0 +1,311 @@
+#ifndef __LBUFFERLAYERED_H__
+#define __LBUFFERLAYERED_H__
+
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <emmintrin.h>
+#include "lib/klib.h"
+#include "lbufferraytable.h"
+#include "lbufferangle.h"
+#include "lbufferspan.h"
+
+
+const unsigned int LBUFFER_LAYER_NO_TAG = 0xFFFFFFFFu; //  
+
+
+// :    
+struct LBufferLayer {
+  float depth;
+  unsigned int tag;
+};
+
+
+/*
+  L-  ,     Layers    
+  (   : , , )    .
+      :  0 - ,     .
+     tag:    ,    ,  
+     .     Clear   LBUFFER_LAYER_NO_TAG.
+   x    2pi * x / size,  0   StaticLBuffer< size >.
+*/
+template< int Layers >
+class LayeredLBuffer
+{
+public:
+  enum {
+    LAYERS = Layers,
+  };
+
+  LayeredLBuffer( int setSize );
+  void Clear( float value );
+  void DrawLine( const Vec2& point0, const Vec2& point1, unsigned int tag );
+  void DrawPolygon( const Vec2 *points, int count, unsigned int tag );
+  int GetLayers( int index, LBufferLayer *outLayers ) const; //     ,   
+  inline int GetSize() const {
+    return this->size;
+  }
+  inline float GetColumnOfPoint( const Vec2& point ) const {
+    return LBufferPointToTurns( point.x, point.y ) * float( this->size );
+  }
+  inline int GetColumnOfAngle( LBufferAngle angle ) const {
+    return int( this->_AngleToColumnFixed( angle ) >> 32 );
+  }
+  inline const float* GetDepthData( int layer ) const {
+    return &this->depth[ layer * this->size ];
+  }
+  inline const unsigned int* GetTagData( int layer ) const {
+    return &this->tags[ layer * this->size ];
+  }
+
+private:
+  static_assert( Layers >= 2 && Layers <= 4, "LayeredLBuffer: Layers must be 2..4" );
+
+  LayeredLBuffer( const LayeredLBuffer& );
+  LayeredLBuffer& operator=( const LayeredLBuffer& );
+  void _Insert( int position, float value, unsigned int tag );
+  void _DrawSegment( const Vec2& point0, const Vec2& point1, LBufferAngle angle0, LBufferAngle angle1, unsigned int tag );
+  void _WriteSpan( int begin, int end, const LBufferLineDepth& generator, unsigned int tag );
+  inline long long _AngleToColumnFixed( LBufferAngle angle ) const {
+    return ( long long ) ( ( unsigned long long ) angle * ( unsigned long long ) this->size );
+  }
+  inline int _Wrap( int position ) const {
+    if( this->sizeMask ) {
+      return position & this->sizeMask;
+    }
+    position %= this->size;
+    return position < 0 ? position + this->size : position;
+  }
+
+  const int size;
+  const int sizeMask; //size - 1  size -  ,  0
+  std::vector< float > depth;       //Layers   size 
+  std::vector< unsigned int > tags;
+  float lightRadius;
+  std::shared_ptr< const LBufferRayTable > rays;
+};
+
+
+
+template< int Layers >
+LayeredLBuffer< Layers >::LayeredLBuffer( int setSize )
+  :size( setSize ), sizeMask( ( setSize & ( setSize - 1 ) ) ? 0 : setSize - 1 ), depth( size_t( setSize ) * Layers ), tags( size_t( setSize ) * Layers ), lightRadius( 1000.0f ), rays( LBufferRayTable::Acquire( setSize, Math::TWO_PI ) )
+{
+  this->Clear( this->lightRadius );
+}
+
+
+
+template< int Layers >
+void LayeredLBuffer< Layers >::Clear( float value ) {
+  this->lightRadius = value;
+  std::fill( this->depth.begin(), this->depth.end(), value );
+  std::fill( this->tags.begin(), this->tags.end(), LBUFFER_LAYER_NO_TAG );
+}//Clear
+
+
+
+/*
+===========
+  DrawLine
+     tag,    
+===========
+*/
+template< int Layers >
+void LayeredLBuffer< Layers >::DrawLine( const Vec2& point0, const Vec2& point1, unsigned int tag ) {
+  this->_DrawSegment( point0, point1, LBufferPointToAngle( point0.x, point0.y ), LBufferPointToAngle( point1.x, point1.y ), tag );
+}//DrawLine
+
+
+
+/*
+===========
+  DrawPolygon
+      tag  count 
+===========
+*/
+template< int Layers >
+void LayeredLBuffer< Layers >::DrawPolygon( const Vec2 *points, int count, unsigned int tag ) {
+  if( count < 2 ) {
+    return;
+  }
+  LBufferAngle anglePrev = LBufferPointToAngle( points[ count - 1 ].x, points[ count - 1 ].y );
+  for( int q = 0, prev = count - 1; q < count; prev = q++ ) {
+    LBufferAngle angle = LBufferPointToAngle( points[ q ].x, points[ q ].y );
+    this->_DrawSegment( points[ prev ], points[ q ], anglePrev, angle, tag );
+    anglePrev = angle;
+  }
+}//DrawPolygon
+
+
+
+template< int Layers >
+int LayeredLBuffer< Layers >::GetLayers( int index, LBufferLayer *outLayers ) const {
+  if( index < 0 || index >= this->size ) {
+    return 0;
+  }
+  int count = 0;
+  for( int layer = 0; layer < Layers; ++layer ) {
+    const size_t offset = size_t( layer ) * this->size + index;
+    if( this->tags[ offset ] == LBUFFER_LAYER_NO_TAG ) {
+      break;
+    }
+    outLayers[ count ].depth = this->depth[ offset ];
+    outLayers[ count ].tag = this->tags[ offset ];
+    ++count;
+  }
+  return count;
+}//GetLayers
+
+
+
+/*
+===========
+  _Insert
+     tag      :     
+  ,   ,    
+===========
+*/
+template< int Layers >
+void LayeredLBuffer< Layers >::_Insert( int position, float value, unsigned int tag ) {
+  float *depth = &this->depth[ position ];
+  unsigned int *tags = &this->tags[ position ];
+  const int size = this->size;
+  if( value < 0.0f ) {
+    value = 0.0f;
+  }
+  for( int layer = 0; layer < Layers; ++layer ) {
+    if( tags[ layer * size ] == tag ) {
+      if( depth[ layer * size ] <= value ) {
+        return;
+      }
+      for( ; layer < Layers - 1; ++layer ) { //  ,    
+        depth[ layer * size ] = depth[ ( layer + 1 ) * size ];
+        tags[ layer * size ] = tags[ ( layer + 1 ) * size ];
+      }
+      depth[ ( Layers - 1 ) * size ] = this->lightRadius;
+      tags[ ( Layers - 1 ) * size ] = LBUFFER_LAYER_NO_TAG;
+      break;
+    }
+  }
+  if( !( value < depth[ ( Layers - 1 ) * size ] ) ) {
+    return;
+  }
+  int layer = Layers - 1;
+  for( ; layer > 0 && depth[ ( layer - 1 ) * size ] > value; --layer ) {
+    depth[ layer * size ] = depth[ ( layer - 1 ) * size ];
+    tags[ layer * size ] = tags[ ( layer - 1 ) * size ];
+  }
+  depth[ layer * size ] = value;
+  tags[ layer * size ] = tag;
+}//_Insert
+
+
+
+/*
+===========
+  _WriteSpan
+      ,         
+===========
+*/
+template< int Layers >
+void LayeredLBuffer< Layers >::_WriteSpan( int begin, int end, const LBufferLineDepth& generator, unsigned int tag ) {
+  const float *last = &this->depth[ size_t( Layers - 1 ) * this->size ];
+  const __m128 zero = _mm_setzero_ps();
+  int x = begin;
+  for( ; x + 4 <= end; x += 4 ) {
+    const __m128 value = _mm_max_ps( generator.Sse( x ), zero );
+    int mask = _mm_movemask_ps( _mm_cmplt_ps( value, _mm_loadu_ps( last + x ) ) );
+    if( !mask ) {
+      continue;
+    }
+    float values[ 4 ];
+    _mm_storeu_ps( values, value );
+    for( int q = 0; mask; ++q, mask >>= 1 ) {
+      if( mask & 1 ) {
+        this->_Insert( x + q, values[ q ], tag );
+      }
+    }
+  }
+  for( ; x < end; ++x ) {
+    const float value = generator.Scalar( x );
+    if( value < last[ x ] ) {
+      this->_Insert( x, value, tag );
+    }
+  }
+}//_WriteSpan
+
+
+
+/*
+===========
+  _DrawSegment
+   ,  StaticLBuffer::_DrawSegment (    ),    
+===========
+*/
+template< int Layers >
+void LayeredLBuffer< Layers >::_DrawSegment( const Vec2& segment0, const Vec2& segment1, LBufferAngle angle0, LBufferAngle angle1, unsigned int tag ) {
+  Vec2 point0( segment0 ),
+       point1( segment1 );
+  float nearest;
+  int clipped;
+  if( !LBufferClipSegment( point0, point1, this->lightRadius, nearest, clipped ) ) {
+    return;
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT0 ) {
+    angle0 = LBufferPointToAngle( point0.x, point0.y );
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT1 ) {
+    angle1 = LBufferPointToAngle( point1.x, point1.y );
+  }
+
+  LBufferAngle angleBegin = angle0,
+               angleEnd = angle1;
+  const float side = point0.x * point1.y - point0.y * point1.x;
+  if( side > 0.0f ) {
+    Math::Swap( angleBegin, angleEnd );
+  } else if( side == 0.0f && point0 * point1 < 0.0f ) { //   
+    this->_Insert( this->_Wrap( this->GetColumnOfAngle( angleBegin ) ), 0.0f, tag );
+    this->_Insert( this->_Wrap( this->GetColumnOfAngle( angleEnd ) ), 0.0f, tag );
+    return;
+  }
+  LBufferAngle arc = angleEnd - angleBegin;
+  if( arc > LBUFFER_ANGLE_HALF + LBUFFER_ANGLE_QUARTER ) { //  
+    arc = 0;
+  }
+  const long long fixedBegin = this->_AngleToColumnFixed( angleBegin );
+  const long long fixedEnd = fixedBegin + this->_AngleToColumnFixed( arc );
+
+  if( ( fixedBegin >> 32 ) == ( fixedEnd >> 32 ) ) { // :   
+    const float value = min( LBufferLength( point0 ), LBufferLength( point1 ) );
+    const int position = this->_Wrap( int( fixedBegin >> 32 ) );
+    if( value < this->depth[ size_t( Layers - 1 ) * this->size + position ] ) {
+      this->_Insert( position, value, tag );
+    }
+    return;
+  }
+
+  const long long error = this->_AngleToColumnFixed( LBUFFER_ANGLE_MAX_ERROR_BINARY );
+  const long long low = fixedBegin - error,
+                  high = fixedEnd + error;
+  int begin = int( ( low + ( 1LL << 32 ) - 1 ) >> 32 ),
+      count = int( high >> 32 ) - begin + 1;
+  if( count > this->size ) {
+    count = this->size;
+  }
+  begin = this->_Wrap( begin );
+
+  LBufferLineDepth generator;
+  generator.Setup( point0, point1, this->lightRadius, *this->rays );
+
+  if( begin + count <= this->size ) {
+    this->_WriteSpan( begin, begin + count, generator, tag );
+  } else {
+    this->_WriteSpan( begin, this->size, generator, tag );
+    this->_WriteSpan( 0, begin + count - this->size, generator, tag );
+  }
+}//_DrawSegment
+
+
+#endif
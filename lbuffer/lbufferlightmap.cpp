@@ -0,0 +1,187 @@
+#include "lbufferlightmap.h"
+#include <string.h>
+#include <xmmintrin.h>
+
+
+const int LBUFFER_LIGHTMAP_TILE_TEXELS = LBUFFER_LIGHTMAP_TILE * LBUFFER_LIGHTMAP_TILE;
+
+
+LBufferLightmap::LBufferLightmap( int setWidth, int setHeight, LBufferLightmapFormat setFormat )
+  :width( setWidth ), height( setHeight ), format( setFormat ),
+  tilesX( ( setWidth + LBUFFER_LIGHTMAP_TILE - 1 ) >> LBUFFER_LIGHTMAP_TILE_SHIFT ), tilesY( ( setHeight + LBUFFER_LIGHTMAP_TILE - 1 ) >> LBUFFER_LIGHTMAP_TILE_SHIFT ),
+  origin( 0.0f, 0.0f ), texelSize( 1.0f ), ambient( 0.0f, 0.0f, 0.0f, 0.0f ), interpolate( true )
+{
+  if( setFormat == LBUFFER_LIGHTMAP_RGBA8 ) {
+    this->byteTarget.assign( size_t( setWidth ) * size_t( setHeight ) * 4, 0 );
+  } else {
+    this->floatTarget.assign( size_t( setWidth ) * size_t( setHeight ) * 4, 0.0f );
+  }
+}
+
+
+LBufferLightmap::~LBufferLightmap() {
+}
+
+
+void LBufferLightmap::SetView( const Vec2& setOrigin, float setTexelSize ) {
+  this->origin = setOrigin;
+  this->texelSize = setTexelSize;
+}//SetView
+
+
+void LBufferLightmap::SetAmbient( const Vec4& setAmbient ) {
+  this->ambient = setAmbient;
+}//SetAmbient
+
+
+void LBufferLightmap::SetInterpolation( bool setInterpolate ) {
+  this->interpolate = setInterpolate;
+}//SetInterpolation
+
+
+void LBufferLightmap::ClearLights() {
+  this->lights.clear();
+}//ClearLights
+
+
+void LBufferLightmap::AddLight( const LBuffer *buffer, const Vec2& position, float radius, const Vec4& color, float falloff ) {
+  if( !buffer || radius <= 0.0f ) {
+    return;
+  }
+  LBufferLightmapLight light;
+  light.buffer = buffer;
+  light.position = position;
+  light.radius = radius;
+  light.invRadiusSquared = 1.0f / ( radius * radius );
+  light.falloff = falloff;
+  light.color = color;
+  this->lights.push_back( light );
+}//AddLight
+
+
+
+/*
+===========
+  Render
+    :    ,   -  
+===========
+*/
+void LBufferLightmap::Render( LBufferThreadPool *pool ) {
+  const int tileCount = this->tilesX * this->tilesY;
+  if( pool ) {
+    pool->Run( tileCount, [ this ]( int tile ) {
+      this->_RenderTile( tile );
+    } );
+  } else {
+    for( int tile = 0; tile < tileCount; ++tile ) {
+      this->_RenderTile( tile );
+    }
+  }
+}//Render
+
+
+
+/*
+===========
+  _RenderTile
+         ,      RGBA    
+===========
+*/
+void LBufferLightmap::_RenderTile( int tile ) {
+  const int tileX = ( tile % this->tilesX ) << LBUFFER_LIGHTMAP_TILE_SHIFT,
+            tileY = ( tile / this->tilesX ) << LBUFFER_LIGHTMAP_TILE_SHIFT;
+  const int tileWidth = min( LBUFFER_LIGHTMAP_TILE, this->width - tileX ),
+            tileHeight = min( LBUFFER_LIGHTMAP_TILE, this->height - tileY );
+  const Vec2 tileMin( this->origin.x + float( tileX ) * this->texelSize, this->origin.y + float( tileY ) * this->texelSize );
+  const Vec2 tileMax( tileMin.x + float( tileWidth ) * this->texelSize, tileMin.y + float( tileHeight ) * this->texelSize );
+
+  float channels[ 4 ][ LBUFFER_LIGHTMAP_TILE_TEXELS ];
+  Vec2 points[ LBUFFER_LIGHTMAP_TILE_TEXELS ];
+  float visibility[ LBUFFER_LIGHTMAP_TILE_TEXELS ];
+  const int texelCount = tileHeight * LBUFFER_LIGHTMAP_TILE; //  tileWidth ,   
+
+  for( int channel = 0; channel < 4; ++channel ) {
+    const __m128 value = _mm_set1_ps( this->ambient[ channel ] );
+    for( int q = 0; q < texelCount; q += 4 ) {
+      _mm_storeu_ps( channels[ channel ] + q, value );
+    }
+  }
+
+  for( auto &light: this->lights ) {
+    const float nearestX = min( max( light.position.x, min( tileMin.x, tileMax.x ) ), max( tileMin.x, tileMax.x ) ) - light.position.x,
+                nearestY = min( max( light.position.y, min( tileMin.y, tileMax.y ) ), max( tileMin.y, tileMax.y ) ) - light.position.y;
+    if( nearestX * nearestX + nearestY * nearestY >= light.radius * light.radius ) {
+      continue;
+    }
+    const Vec2 first( tileMin.x + 0.5f * this->texelSize - light.position.x, tileMin.y + 0.5f * this->texelSize - light.position.y );
+    for( int y = 0, q = 0; y < tileHeight; ++y ) {
+      const float pointY = first.y + float( y ) * this->texelSize;
+      for( int x = 0; x < LBUFFER_LIGHTMAP_TILE; ++x, ++q ) {
+        points[ q ].x = first.x + float( x ) * this->texelSize;
+        points[ q ].y = pointY;
+      }
+    }
+    light.buffer->QueryAttenuation( points, texelCount, visibility, this->interpolate );
+
+    const __m128 invRadiusSquared = _mm_set1_ps( light.invRadiusSquared ),
+                 falloff = _mm_set1_ps( light.falloff ),
+                 one = _mm_set1_ps( 1.0f ),
+                 zero = _mm_setzero_ps();
+    const __m128 color[ 4 ] = { _mm_set1_ps( light.color.x ), _mm_set1_ps( light.color.y ), _mm_set1_ps( light.color.z ), _mm_set1_ps( light.color.w ) };
+    for( int q = 0; q < texelCount; q += 4 ) {
+      const __m128 xy01 = _mm_loadu_ps( &points[ q ].x ),
+                   xy23 = _mm_loadu_ps( &points[ q + 2 ].x );
+      const __m128 x = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 2, 0, 2, 0 ) ),
+                   y = _mm_shuffle_ps( xy01, xy23, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+      const __m128 distanceSquared = _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) );
+      const __m128 window = _mm_max_ps( _mm_sub_ps( one, _mm_mul_ps( distanceSquared, invRadiusSquared ) ), zero );
+      const __m128 contribution = _mm_div_ps( _mm_mul_ps( window, _mm_loadu_ps( visibility + q ) ), _mm_add_ps( one, _mm_mul_ps( falloff, distanceSquared ) ) );
+      if( !_mm_movemask_ps( _mm_cmpgt_ps( contribution, zero ) ) ) {
+        continue;
+      }
+      for( int channel = 0; channel < 4; ++channel ) {
+        _mm_storeu_ps( channels[ channel ] + q, _mm_add_ps( _mm_loadu_ps( channels[ channel ] + q ), _mm_mul_ps( contribution, color[ channel ] ) ) );
+      }
+    }
+  }
+
+  //  RGBA:         RGBA
+  const __m128 one = _mm_set1_ps( 1.0f ),
+               zero = _mm_setzero_ps(),
+               byteScale = _mm_set1_ps( 255.0f ),
+               half = _mm_set1_ps( 0.5f );
+  for( int y = 0; y < tileHeight; ++y ) {
+    const size_t rowOffset = ( size_t( tileY + y ) * size_t( this->width ) + size_t( tileX ) ) * 4;
+    for( int x = 0; x < tileWidth; x += 4 ) {
+      const int q = y * LBUFFER_LIGHTMAP_TILE + x;
+      __m128 r = _mm_loadu_ps( channels[ 0 ] + q ),
+             g = _mm_loadu_ps( channels[ 1 ] + q ),
+             b = _mm_loadu_ps( channels[ 2 ] + q ),
+             a = _mm_loadu_ps( channels[ 3 ] + q );
+      _MM_TRANSPOSE4_PS( r, g, b, a );
+      const int count = min( tileWidth - x, 4 );
+      if( this->format == LBUFFER_LIGHTMAP_RGBA8 ) {
+        const __m128i rg = _mm_packs_epi32(
+          _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_min_ps( _mm_max_ps( r, zero ), one ), byteScale ), half ) ),
+          _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_min_ps( _mm_max_ps( g, zero ), one ), byteScale ), half ) ) );
+        const __m128i ba = _mm_packs_epi32(
+          _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_min_ps( _mm_max_ps( b, zero ), one ), byteScale ), half ) ),
+          _mm_cvttps_epi32( _mm_add_ps( _mm_mul_ps( _mm_min_ps( _mm_max_ps( a, zero ), one ), byteScale ), half ) ) );
+        unsigned char *out = &this->byteTarget[ rowOffset + size_t( x ) * 4 ];
+        if( count == 4 ) {
+          _mm_storeu_si128( reinterpret_cast< __m128i* >( out ), _mm_packus_epi16( rg, ba ) );
+        } else {
+          unsigned char texels[ 16 ];
+          _mm_storeu_si128( reinterpret_cast< __m128i* >( texels ), _mm_packus_epi16( rg, ba ) );
+          memcpy( out, texels, size_t( count ) * 4 );
+        }
+      } else {
+        float *out = &this->floatTarget[ rowOffset + size_t( x ) * 4 ];
+        const __m128 texels[ 4 ] = { r, g, b, a };
+        for( int k = 0; k < count; ++k ) {
+          _mm_storeu_ps( out + k * 4, texels[ k ] );
+        }
+      }
+    }
+  }
+}//_RenderTile
@@ -0,0 +1,93 @@
+#ifndef __LBUFFERLIGHTMAP_H__
+#define __LBUFFERLIGHTMAP_H__
+
+
+#include <vector>
+#include "lbuffer.h"
+#include "lbufferthreadpool.h"
+
+
+const int LBUFFER_LIGHTMAP_TILE_SHIFT = 5; //   -  32x32 ,   
+const int LBUFFER_LIGHTMAP_TILE = 1 << LBUFFER_LIGHTMAP_TILE_SHIFT;
+
+
+enum LBufferLightmapFormat {
+  LBUFFER_LIGHTMAP_RGBA_FLOAT,  //4 float  ,  
+  LBUFFER_LIGHTMAP_RGBA8,       //4   ,    1.0
+};
+
+
+//  : L-       position
+struct LBufferLightmapLight {
+  const LBuffer *buffer;
+  Vec2 position;
+  float radius;
+  float invRadiusSquared;
+  float falloff;
+  Vec4 color;
+};
+
+
+/*
+      L-:    color * attenuation  ,
+   L-   ,  ambient.
+  attenuation = ( 1 - d^2 / radius^2 ) / ( 1 + falloff * d^2 ), d -      :
+       , falloff    (0 -  ).
+      LBUFFER_LIGHTMAP_TILE x LBUFFER_LIGHTMAP_TILE;    ,
+      ,    LBuffer::QueryAttenuation,
+      -   .      .
+    ( x, y )   : origin + ( x + 0.5, y + 0.5 ) * texelSize.
+  L-    Render  .
+*/
+class LBufferLightmap
+{
+public:
+  LBufferLightmap( int setWidth, int setHeight, LBufferLightmapFormat setFormat = LBUFFER_LIGHTMAP_RGBA_FLOAT );
+  virtual ~LBufferLightmap();
+  void SetView( const Vec2& setOrigin, float setTexelSize );
+  void SetAmbient( const Vec4& setAmbient );
+  void SetInterpolation( bool setInterpolate ); //      L-,   
+  void ClearLights();
+  void AddLight( const LBuffer *buffer, const Vec2& position, float radius, const Vec4& color, float falloff = 0.0f );
+  void Render( LBufferThreadPool *pool = NULL );
+  inline int GetWidth() const {
+    return this->width;
+  }
+  inline int GetHeight() const {
+    return this->height;
+  }
+  inline LBufferLightmapFormat GetFormat() const {
+    return this->format;
+  }
+  inline int GetLightCount() const {
+    return int( this->lights.size() );
+  }
+  inline const float* GetFloatData() const { //LBUFFER_LIGHTMAP_RGBA_FLOAT,   width * 4
+    return this->floatTarget.data();
+  }
+  inline const unsigned char* GetByteData() const { //LBUFFER_LIGHTMAP_RGBA8,   width * 4
+    return this->byteTarget.data();
+  }
+
+private:
+  LBufferLightmap();
+  LBufferLightmap( const LBufferLightmap& );
+  LBufferLightmap& operator=( const LBufferLightmap& );
+  void _RenderTile( int tile );
+
+  const int width;
+  const int height;
+  const LBufferLightmapFormat format;
+  const int tilesX;
+  const int tilesY;
+  Vec2 origin;
+  float texelSize;
+  Vec4 ambient;
+  bool interpolate;
+  std::vector< LBufferLightmapLight > lights;
+  std::vector< float > floatTarget;
+  std::vector< unsigned char > byteTarget;
+};
+
+
+#endif
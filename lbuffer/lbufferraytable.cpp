@@ -0,0 +1,70 @@
+#include "lbufferraytable.h"
+#include "math.h"
+
+
+LBufferRayTable::Registry LBufferRayTable::registry;
+std::vector< std::shared_ptr< const LBufferRayTable > > LBufferRayTable::permanent;
+std::mutex LBufferRayTable::registryMutex;
+
+
+LBufferRayTable::LBufferRayTable( int setSize, float setFloatSize )
+  :size( setSize ), sizeFloat( setFloatSize ), cos( setSize + 1 ), sin( setSize + 1 )
+{
+  //  -   size,      
+  const double step = double( setFloatSize ) / double( setSize );
+  for( int x = 0; x <= setSize; ++x ) {
+    this->cos[ x ] = float( ::cos( double( x ) * step ) );
+    this->sin[ x ] = float( ::sin( double( x ) * step ) );
+  }
+}
+
+
+LBufferRayTable::~LBufferRayTable() {
+}
+
+
+/*
+===========
+  Acquire
+       ( size, sizeFloat ),    
+  ;        
+===========
+*/
+std::shared_ptr< const LBufferRayTable > LBufferRayTable::Acquire( int setSize, float setFloatSize ) {
+  std::lock_guard< std::mutex > lock( registryMutex );
+  std::weak_ptr< const LBufferRayTable > &slot = registry[ Key( setSize, setFloatSize ) ];
+  std::shared_ptr< const LBufferRayTable > table = slot.lock();
+  if( !table ) {
+    for( Registry::iterator iter = registry.begin(); iter != registry.end(); ) {
+      if( iter->second.expired() && &iter->second != &slot ) {
+        iter = registry.erase( iter );
+      } else {
+        ++iter;
+      }
+    }
+    table.reset( new LBufferRayTable( setSize, setFloatSize ) );
+    slot = table;
+  }
+  return table;
+}//Acquire
+
+
+
+/*
+===========
+  AcquirePermanent
+   ,  Acquire,       :  ,  
+           (. StaticLBuffer)
+===========
+*/
+const LBufferRayTable* LBufferRayTable::AcquirePermanent( int setSize, float setFloatSize ) {
+  std::shared_ptr< const LBufferRayTable > table = Acquire( setSize, setFloatSize );
+  std::lock_guard< std::mutex > lock( registryMutex );
+  for( size_t q = 0; q < permanent.size(); ++q ) {
+    if( permanent[ q ] == table ) {
+      return table.get();
+    }
+  }
+  permanent.push_back( table );
+  return table.get();
+}//AcquirePermanent
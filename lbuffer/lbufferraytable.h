@@ -0,0 +1,50 @@
+#ifndef __LBUFFERRAYTABLE_H__
+#define __LBUFFERRAYTABLE_H__
+
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+
+/*
+      L-  .
+    x    a = x * sizeFloat / size: ( cos[ x ], -sin[ x ] ).
+             .
+*/
+class LBufferRayTable
+{
+public:
+  virtual ~LBufferRayTable();
+  static std::shared_ptr< const LBufferRayTable > Acquire( int setSize, float setFloatSize );
+  static const LBufferRayTable* AcquirePermanent( int setSize, float setFloatSize );
+  inline const float* GetCos() const {
+    return &this->cos[ 0 ];
+  }
+  inline const float* GetSin() const {
+    return &this->sin[ 0 ];
+  }
+  inline int GetSize() const {
+    return this->size;
+  }
+
+private:
+  LBufferRayTable( int setSize, float setFloatSize );
+  LBufferRayTable( const LBufferRayTable& );
+  LBufferRayTable& operator=( const LBufferRayTable& );
+
+  typedef std::pair< int, float > Key;
+  typedef std::map< Key, std::weak_ptr< const LBufferRayTable > > Registry;
+  static Registry registry;
+  static std::vector< std::shared_ptr< const LBufferRayTable > > permanent; // AcquirePermanent,    
+  static std::mutex registryMutex;
+
+  const int size;
+  const float sizeFloat;
+  std::vector< float > cos;
+  std::vector< float > sin;
+};
+
+
+#endif
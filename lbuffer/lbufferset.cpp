@@ -0,0 +1,358 @@
+#include "lbufferset.h"
+#include <xmmintrin.h>
+
+
+LBufferSet::LBufferSet( int setLightCount, int setSize, LBufferStorage setStorage )
+  :lightCount( setLightCount ), size( setSize ), storage( setStorage ), stride( ( LBuffer::GetBufferBytes( setSize, setStorage ) + LBUFFER_SET_ALIGN - 1 ) & ~( LBUFFER_SET_ALIGN - 1 ) ),
+  lightX( ( setLightCount + 3 ) & ~3, 1.0e30f ), lightY( ( setLightCount + 3 ) & ~3, 1.0e30f ), lightRadius( ( setLightCount + 3 ) & ~3, 0.0f )
+{
+  this->memory = static_cast< char* >( _mm_malloc( size_t( this->stride ) * size_t( setLightCount ), LBUFFER_SET_ALIGN ) );
+  this->buffers.resize( setLightCount );
+  this->views.resize( setLightCount );
+  this->lightParts.assign( setLightCount, 1 );
+  for( int q = 0; q < setLightCount; ++q ) {
+    this->buffers[ q ] = new LBuffer( setSize, Math::TWO_PI, setStorage, this->memory + size_t( this->stride ) * size_t( q ) );
+    this->lightX[ q ] = 0.0f;
+    this->lightY[ q ] = 0.0f;
+    this->lightRadius[ q ] = 1000.0f;
+  }
+  this->visible.reserve( setLightCount );
+}
+
+
+LBufferSet::~LBufferSet() {
+  for( auto &buffer: this->buffers ) {
+    delete buffer;
+  }
+  for( auto &lightViews: this->views ) {
+    for( auto &view: lightViews ) {
+      delete view;
+    }
+  }
+  _mm_free( this->memory );
+}
+
+
+void LBufferSet::SetLight( int light, const Vec2& position, float radius ) {
+  this->lightX[ light ] = position.x;
+  this->lightY[ light ] = position.y;
+  this->lightRadius[ light ] = radius;
+}//SetLight
+
+
+void LBufferSet::Clear() {
+  for( int q = 0; q < this->lightCount; ++q ) {
+    this->buffers[ q ]->Clear( this->lightRadius[ q ] );
+  }
+}//Clear
+
+
+/*
+===========
+  DrawLine
+   ,    ,     
+===========
+*/
+void LBufferSet::DrawLine( const Vec2& point0, const Vec2& point1 ) {
+  const int count = this->_CullLights( ( point0 + point1 ) * 0.5f, ( point1 - point0 ).Length() * 0.5f );
+  for( int q = 0; q < count; ++q ) {
+    const int light = this->visible[ q ];
+    const Vec2 position( this->lightX[ light ], this->lightY[ light ] );
+    this->buffers[ light ]->DrawLine( NULL, point0 - position, point1 - position );
+  }
+}//DrawLine
+
+
+void LBufferSet::DrawPolygon( const Vec2 *points, int count ) {
+  if( count < 1 ) {
+    return;
+  }
+  Vec2 center;
+  float radius;
+  this->_GetBounds( points, count, center, radius );
+  const int visibleCount = this->_CullLights( center, radius );
+  for( int q = 0; q < visibleCount; ++q ) {
+    const int light = this->visible[ q ];
+    this->buffers[ light ]->DrawPolygon( NULL, this->_ToLightSpace( light, points, count ), count );
+  }
+}//DrawPolygon
+
+
+void LBufferSet::DrawPolygonOccluder( const Vec2 *points, int count ) {
+  if( count < 1 ) {
+    return;
+  }
+  Vec2 center;
+  float radius;
+  this->_GetBounds( points, count, center, radius );
+  const int visibleCount = this->_CullLights( center, radius );
+  for( int q = 0; q < visibleCount; ++q ) {
+    const int light = this->visible[ q ];
+    this->buffers[ light ]->DrawPolygonOccluder( NULL, this->_ToLightSpace( light, points, count ), count );
+  }
+}//DrawPolygonOccluder
+
+
+/*
+===========
+  DrawSegments
+     :            
+===========
+*/
+void LBufferSet::DrawSegments( const Vec2 *points, int segmentCount ) {
+  for( int q = 0; q < segmentCount * 2; q += 2 ) {
+    this->DrawLine( points[ q ], points[ q + 1 ] );
+  }
+}//DrawSegments
+
+
+/*
+===========
+  Render
+         ;       -  
+===========
+*/
+void LBufferSet::Render( const LBufferOccluderSet& occluders, LBufferThreadPool *pool ) {
+  this->_PlanJobs( pool && pool->GetThreadCount() > 1 );
+  if( pool ) {
+    pool->Run( int( this->jobs.size() ), [ this, &occluders ]( int job ) {
+      this->_RenderPart( this->jobs[ job ], occluders );
+    } );
+  } else {
+    for( auto &job: this->jobs ) {
+      this->_RenderPart( job, occluders );
+    }
+  }
+  for( int q = 0; q < this->lightCount; ++q ) { //   ,     
+    if( this->lightParts[ q ] > 1 ) {
+      this->buffers[ q ]->SetColumnWindow( 0, this->size );
+    }
+  }
+}//Render
+
+
+
+/*
+===========
+  _PlanJobs
+     :     ,      
+  (   )  
+===========
+*/
+void LBufferSet::_PlanJobs( bool split ) {
+  const int tiles = ( this->size + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT;
+  const int partsMax = split ? min( LBUFFER_SET_PARTS_MAX, tiles ) : 1;
+  float meanSquare = 0.0f;
+  for( int q = 0; q < this->lightCount; ++q ) {
+    meanSquare += this->lightRadius[ q ] * this->lightRadius[ q ];
+  }
+  meanSquare /= float( max( this->lightCount, 1 ) );
+
+  this->jobs.clear();
+  for( int light = 0; light < this->lightCount; ++light ) {
+    int parts = 1;
+    if( partsMax > 1 && meanSquare > 0.0f ) {
+      parts = max( 1, min( partsMax, int( this->lightRadius[ light ] * this->lightRadius[ light ] / meanSquare ) ) );
+    }
+    this->lightParts[ light ] = parts;
+    std::vector< LBuffer* > &lightViews = this->views[ light ];
+    while( int( lightViews.size() ) < parts - 1 ) {
+      lightViews.push_back( new LBuffer( this->size, Math::TWO_PI, this->storage, this->memory + size_t( this->stride ) * size_t( light ) ) );
+    }
+    for( int part = 0; part < parts; ++part ) {
+      RenderJob job;
+      job.light = light;
+      job.part = part;
+      this->jobs.push_back( job );
+    }
+  }
+}//_PlanJobs
+
+
+
+/*
+===========
+  _RenderPart
+    :      ,      .
+       ,  ,    .
+===========
+*/
+void LBufferSet::_RenderPart( const RenderJob& job, const LBufferOccluderSet& occluders ) {
+  const int light = job.light,
+            parts = this->lightParts[ light ];
+  LBuffer &buffer = ( job.part ? *this->views[ light ][ job.part - 1 ] : *this->buffers[ light ] );
+  const float radius = this->lightRadius[ light ];
+  const Vec2 position( this->lightX[ light ], this->lightY[ light ] );
+  const int tiles = ( this->size + LBUFFER_TILE_SIZE - 1 ) >> LBUFFER_TILE_SHIFT;
+  const int columnBegin = ( tiles * job.part / parts ) << LBUFFER_TILE_SHIFT,
+            columnEnd = min( ( tiles * ( job.part + 1 ) / parts ) << LBUFFER_TILE_SHIFT, this->size );
+  buffer.SetColumnWindow( columnBegin, columnEnd );
+  buffer.Clear( radius );
+
+  //   :        
+  const float invSize = 1.0f / float( this->size ),
+              sectorMiddle = float( columnBegin + columnEnd - 1 ) * 0.5f * invSize,
+              sectorHalf = float( columnEnd - columnBegin + 1 ) * 0.5f * invSize + invSize;
+
+  const __m128 positionX = _mm_set1_ps( position.x ),
+               positionY = _mm_set1_ps( position.y ),
+               lightRadius = _mm_set1_ps( radius );
+  Vec2 localStatic[ LBUFFER_POLYGON_LOCAL_VERTICES ];
+  std::vector< Vec2 > localHeap;
+  for( int q = 0, count = int( occluders.boundsRadius.size() ); q < count; q += 4 ) {
+    const __m128 dx = _mm_sub_ps( _mm_loadu_ps( &occluders.boundsX[ q ] ), positionX ),
+                 dy = _mm_sub_ps( _mm_loadu_ps( &occluders.boundsY[ q ] ), positionY ),
+                 reach = _mm_add_ps( _mm_loadu_ps( &occluders.boundsRadius[ q ] ), lightRadius );
+    int mask = _mm_movemask_ps( _mm_cmplt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( reach, reach ) ) );
+    for( int shapeIndex = q; mask; mask >>= 1, ++shapeIndex ) {
+      if( !( mask & 1 ) ) {
+        continue;
+      }
+      if( parts > 1 ) { //      
+        const Vec2 center( occluders.boundsX[ shapeIndex ] - position.x, occluders.boundsY[ shapeIndex ] - position.y );
+        const float distance = center.Length(),
+                    boundsRadius = occluders.boundsRadius[ shapeIndex ];
+        if( distance > boundsRadius ) {
+          float delta = LBufferPointToTurns( center.x, center.y ) - sectorMiddle;
+          delta -= floorf( delta + 0.5f );
+          if( Math::Fabs( delta ) > sectorHalf + asinf( boundsRadius / distance ) * ( 0.5f / Math::PI ) ) {
+            continue;
+          }
+        }
+      }
+      const LBufferOccluderSet::Shape &shape = occluders.shapes[ shapeIndex ];
+      const Vec2 *points = &occluders.points[ shape.first ];
+      Vec2 *local = localStatic;
+      if( shape.count > LBUFFER_POLYGON_LOCAL_VERTICES ) {
+        localHeap.resize( shape.count );
+        local = &localHeap[ 0 ];
+      }
+      for( int k = 0; k < shape.count; ++k ) {
+        local[ k ] = points[ k ] - position;
+      }
+      switch( shape.type ) {
+      case LBufferOccluderSet::SHAPE_SEGMENT:
+        buffer.DrawLine( NULL, local[ 0 ], local[ 1 ] );
+        break;
+      case LBufferOccluderSet::SHAPE_POLYLINE:
+        buffer.DrawPolyline( NULL, local, shape.count );
+        break;
+      case LBufferOccluderSet::SHAPE_POLYGON:
+        buffer.DrawPolygonOccluder( NULL, local, shape.count );
+        break;
+      }
+    }
+  }
+}//_RenderPart
+
+
+
+/*
+===========
+  _CullLights
+  ,     ( center, radius ),    ;   visible
+===========
+*/
+int LBufferSet::_CullLights( const Vec2& center, float radius ) {
+  this->visible.clear();
+  const __m128 centerX = _mm_set1_ps( center.x ),
+               centerY = _mm_set1_ps( center.y ),
+               objectRadius = _mm_set1_ps( radius );
+  for( int q = 0, count = int( this->lightRadius.size() ); q < count; q += 4 ) {
+    const __m128 dx = _mm_sub_ps( _mm_loadu_ps( &this->lightX[ q ] ), centerX ),
+                 dy = _mm_sub_ps( _mm_loadu_ps( &this->lightY[ q ] ), centerY ),
+                 reach = _mm_add_ps( _mm_loadu_ps( &this->lightRadius[ q ] ), objectRadius );
+    int mask = _mm_movemask_ps( _mm_cmplt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( reach, reach ) ) );
+    for( int light = q; mask; mask >>= 1, ++light ) {
+      if( mask & 1 ) {
+        this->visible.push_back( light );
+      }
+    }
+  }
+  return int( this->visible.size() );
+}//_CullLights
+
+
+//  :      
+void LBufferSet::_GetBounds( const Vec2 *points, int count, Vec2& outCenter, float& outRadius ) {
+  Vec2 low( points[ 0 ] ),
+       high( points[ 0 ] );
+  for( int q = 1; q < count; ++q ) {
+    low.Set( min( low.x, points[ q ].x ), min( low.y, points[ q ].y ) );
+    high.Set( max( high.x, points[ q ].x ), max( high.y, points[ q ].y ) );
+  }
+  outCenter = ( low + high ) * 0.5f;
+  outRadius = ( high - low ).Length() * 0.5f;
+}//_GetBounds
+
+
+//    ,     
+const Vec2* LBufferSet::_ToLightSpace( int light, const Vec2 *points, int count ) {
+  this->localPoints.resize( count );
+  const Vec2 position( this->lightX[ light ], this->lightY[ light ] );
+  for( int q = 0; q < count; ++q ) {
+    this->localPoints[ q ] = points[ q ] - position;
+  }
+  return &this->localPoints[ 0 ];
+}//_ToLightSpace
+
+
+
+LBufferOccluderSet::LBufferOccluderSet() {
+}
+
+
+LBufferOccluderSet::~LBufferOccluderSet() {
+}
+
+
+void LBufferOccluderSet::Clear() {
+  this->points.clear();
+  this->shapes.clear();
+  this->boundsX.clear();
+  this->boundsY.clear();
+  this->boundsRadius.clear();
+}//Clear
+
+
+void LBufferOccluderSet::AddSegment( const Vec2& point0, const Vec2& point1 ) {
+  const Vec2 segment[ 2 ] = { point0, point1 };
+  this->_AddShape( SHAPE_SEGMENT, segment, 2 );
+}//AddSegment
+
+
+void LBufferOccluderSet::AddPolyline( const Vec2 *points, int count ) {
+  if( count >= 2 ) {
+    this->_AddShape( SHAPE_POLYLINE, points, count );
+  }
+}//AddPolyline
+
+
+void LBufferOccluderSet::AddPolygon( const Vec2 *points, int count ) {
+  if( count >= 2 ) {
+    this->_AddShape( SHAPE_POLYGON, points, count );
+  }
+}//AddPolygon
+
+
+void LBufferOccluderSet::_AddShape( ShapeType type, const Vec2 *points, int count ) {
+  Shape shape;
+  shape.type = type;
+  shape.first = int( this->points.size() );
+  shape.count = count;
+  this->points.insert( this->points.end(), points, points + count );
+  Vec2 center;
+  float radius;
+  LBufferSet::_GetBounds( points, count, center, radius );
+  //       ,  -  
+  const int index = int( this->shapes.size() );
+  this->shapes.push_back( shape );
+  if( int( this->boundsRadius.size() ) <= index ) {
+    this->boundsX.resize( index + 4, 1.0e30f );
+    this->boundsY.resize( index + 4, 1.0e30f );
+    this->boundsRadius.resize( index + 4, 0.0f );
+  }
+  this->boundsX[ index ] = center.x;
+  this->boundsY[ index ] = center.y;
+  this->boundsRadius[ index ] = radius;
+}//_AddShape
@@ -0,0 +1,129 @@
+#ifndef __LBUFFERSET_H__
+#define __LBUFFERSET_H__
+
+
+#include <vector>
+#include "lbuffer.h"
+#include "lbufferthreadpool.h"
+
+
+const int LBUFFER_SET_ALIGN = 64; //       
+const int LBUFFER_SET_PARTS_MAX = 8; //   ,      Render
+
+
+/*
+         LBufferSet::Render.
+     ,         .
+               .
+*/
+class LBufferOccluderSet
+{
+public:
+  enum ShapeType {
+    SHAPE_SEGMENT,    //, DrawLine
+    SHAPE_POLYLINE,   //, DrawPolyline
+    SHAPE_POLYGON,    //  , DrawPolygonOccluder
+  };
+  struct Shape {
+    ShapeType type;
+    int first;        //   points
+    int count;
+  };
+
+  LBufferOccluderSet();
+  virtual ~LBufferOccluderSet();
+  void Clear();
+  void AddSegment( const Vec2& point0, const Vec2& point1 );
+  void AddPolyline( const Vec2 *points, int count );
+  void AddPolygon( const Vec2 *points, int count );
+  inline int GetShapeCount() const {
+    return int( this->shapes.size() );
+  }
+
+private:
+  friend class LBufferSet;
+  void _AddShape( ShapeType type, const Vec2 *points, int count );
+
+  std::vector< Vec2 > points;
+  std::vector< Shape > shapes;
+  std::vector< float > boundsX;       //      
+  std::vector< float > boundsY;
+  std::vector< float > boundsRadius;
+};
+
+
+/*
+   L-       .
+          ,   -    ,
+        .
+       :      , 
+              .
+       .
+  Render       (      )   
+    :   -  ,       
+   LBuffer    ,       .
+*/
+class LBufferSet
+{
+public:
+  LBufferSet( int setLightCount, int setSize, LBufferStorage setStorage = LBUFFER_STORAGE_FLOAT );
+  virtual ~LBufferSet();
+  void SetLight( int light, const Vec2& position, float radius );
+  void Clear();
+  void DrawLine( const Vec2& point0, const Vec2& point1 );
+  void DrawPolygon( const Vec2 *points, int count );
+  void DrawPolygonOccluder( const Vec2 *points, int count );
+  void DrawSegments( const Vec2 *points, int segmentCount );
+  void Render( const LBufferOccluderSet& occluders, LBufferThreadPool *pool = NULL );
+  inline int GetLightParts( int light ) const { //     Render
+    return this->lightParts[ light ];
+  }
+  inline int GetLightCount() const {
+    return this->lightCount;
+  }
+  inline int GetSize() const {
+    return this->size;
+  }
+  inline LBuffer& GetBuffer( int light ) {
+    return *this->buffers[ light ];
+  }
+  inline Vec2 GetLightPosition( int light ) const {
+    return Vec2( this->lightX[ light ], this->lightY[ light ] );
+  }
+  inline float GetLightRadius( int light ) const {
+    return this->lightRadius[ light ];
+  }
+
+private:
+  LBufferSet();
+  LBufferSet( const LBufferSet& );
+  LBufferSet& operator=( const LBufferSet& );
+  friend class LBufferOccluderSet;
+  int _CullLights( const Vec2& center, float radius );
+  struct RenderJob {
+    int light;
+    int part;
+  };
+  void _PlanJobs( bool split );
+  void _RenderPart( const RenderJob& job, const LBufferOccluderSet& occluders );
+  static void _GetBounds( const Vec2 *points, int count, Vec2& outCenter, float& outRadius );
+  const Vec2* _ToLightSpace( int light, const Vec2 *points, int count );
+
+  const int lightCount;
+  const int size;
+  const LBufferStorage storage;
+  const int stride;               //    memory
+  char *memory;
+  std::vector< LBuffer* > buffers;
+  std::vector< std::vector< LBuffer* > > views; //  1, 2, ...     
+  std::vector< int > lightParts;
+  std::vector< RenderJob > jobs;
+  std::vector< float > lightX;    //      
+  std::vector< float > lightY;
+  std::vector< float > lightRadius;
+  std::vector< int > visible;     //,   
+  std::vector< Vec2 > localPoints;
+};
+
+
+#endif
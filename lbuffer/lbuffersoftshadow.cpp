@@ -0,0 +1,233 @@
+#include "lbuffersoftshadow.h"
+
+
+LBufferSoftShadow::LBufferSoftShadow()
+  :size( 0 ), fullCircle( false ), columnsPerTurn( 0.0f ), depthScale( 1.0f ), minVariance( 0.0f ), minVarianceDepth( 0.0f ), bleedReduction( 0.0f )
+{
+  Moments empty = { 0, 0 };
+  this->prefix.assign( 1, empty );
+}
+
+
+LBufferSoftShadow::~LBufferSoftShadow() {
+}
+
+
+void LBufferSoftShadow::SetMinVariance( float variance ) {
+  this->minVarianceDepth = max( variance, 0.0f );
+  this->minVariance = this->minVarianceDepth * this->depthScale * this->depthScale;
+}//SetMinVariance
+
+
+void LBufferSoftShadow::SetBleedReduction( float amount ) {
+  this->bleedReduction = min( max( amount, 0.0f ), 0.99f );
+}//SetBleedReduction
+
+
+
+/*
+===========
+  Build
+        
+===========
+*/
+void LBufferSoftShadow::Build( const LBuffer& source ) {
+  this->size = source.size;
+  this->fullCircle = source.fullCircle;
+  this->columnsPerTurn = source.columnsPerTurn;
+  this->depthScale = LBUFFER_SOFT_SHADOW_LEVELS / ( source.lightRadius > 0.0f ? source.lightRadius : 1.0f );
+  this->minVariance = this->minVarianceDepth * this->depthScale * this->depthScale;
+  this->prefix.resize( this->size + 1 );
+  this->prefix[ 0 ].sum = 0;
+  this->prefix[ 0 ].sumSquares = 0;
+
+  switch( source.storage ) {
+  case LBUFFER_STORAGE_UINT16: //      
+    this->_Accumulate( source.buffer16 );
+    break;
+  case LBUFFER_STORAGE_HALF: {
+    this->decoded.resize( this->size );
+    LBufferHalfEncoder encoder;
+    for( int x = 0; x < this->size; ++x ) {
+      this->decoded[ x ] = encoder.Decode( source.buffer16[ x ] );
+    }
+    this->_Accumulate( this->decoded.data() );
+    break;
+  }
+  case LBUFFER_STORAGE_UINT8_LOG: {
+    this->decoded.resize( this->size );
+    LBufferLog8Encoder encoder( source.lightRadius );
+    for( int x = 0; x < this->size; ++x ) {
+      this->decoded[ x ] = encoder.Decode( source.buffer8[ x ] );
+    }
+    this->_Accumulate( this->decoded.data() );
+    break;
+  }
+  default:
+    this->_Accumulate( source.buffer );
+  }
+}//Build
+
+
+
+inline void LBufferSoftShadow::_AddCodes( __m128i codes, __m128i& running, Moments *out ) {
+  const __m128i even = _mm_and_si128( codes, _mm_set_epi32( 0, -1, 0, -1 ) ),
+                odd = _mm_srli_epi64( codes, 32 ),
+                evenSquares = _mm_mul_epu32( codes, codes ),
+                oddSquares = _mm_mul_epu32( odd, odd );
+  running = _mm_add_epi64( running, _mm_unpacklo_epi64( even, evenSquares ) );
+  _mm_storeu_si128( reinterpret_cast< __m128i* >( out ), running );
+  running = _mm_add_epi64( running, _mm_unpacklo_epi64( odd, oddSquares ) );
+  _mm_storeu_si128( reinterpret_cast< __m128i* >( out + 1 ), running );
+  running = _mm_add_epi64( running, _mm_unpackhi_epi64( even, evenSquares ) );
+  _mm_storeu_si128( reinterpret_cast< __m128i* >( out + 2 ), running );
+  running = _mm_add_epi64( running, _mm_unpackhi_epi64( odd, oddSquares ) );
+  _mm_storeu_si128( reinterpret_cast< __m128i* >( out + 3 ), running );
+}//_AddCodes
+
+
+
+/*
+===========
+  _Accumulate
+         ;        128- 
+===========
+*/
+void LBufferSoftShadow::_Accumulate( const float *values ) {
+  Moments *out = &this->prefix[ 1 ];
+  __m128i running = _mm_setzero_si128();
+  const __m128 scale = _mm_set1_ps( this->depthScale ),
+               half = _mm_set1_ps( 0.5f ),
+               top = _mm_set1_ps( LBUFFER_SOFT_SHADOW_LEVELS ),
+               zero = _mm_setzero_ps();
+  int x = 0;
+  for( ; x + 4 <= this->size; x += 4 ) {
+    const __m128 code = _mm_min_ps( _mm_max_ps( _mm_add_ps( _mm_mul_ps( _mm_loadu_ps( values + x ), scale ), half ), zero ), top );
+    _AddCodes( _mm_cvttps_epi32( code ), running, out + x );
+  }
+  for( ; x < this->size; ++x ) {
+    const unsigned long long code = ( unsigned long long ) min( max( values[ x ] * this->depthScale + 0.5f, 0.0f ), LBUFFER_SOFT_SHADOW_LEVELS );
+    out[ x ].sum = this->prefix[ x ].sum + code;
+    out[ x ].sumSquares = this->prefix[ x ].sumSquares + code * code;
+  }
+}//_Accumulate
+
+
+void LBufferSoftShadow::_Accumulate( const unsigned short *codes ) {
+  Moments *out = &this->prefix[ 1 ];
+  __m128i running = _mm_setzero_si128();
+  int x = 0;
+  for( ; x + 4 <= this->size; x += 4 ) {
+    const __m128i code = _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast< const __m128i* >( codes + x ) ), _mm_setzero_si128() );
+    _AddCodes( code, running, out + x );
+  }
+  for( ; x < this->size; ++x ) {
+    const unsigned long long code = codes[ x ];
+    out[ x ].sum = this->prefix[ x ].sum + code;
+    out[ x ].sumSquares = this->prefix[ x ].sumSquares + code * code;
+  }
+}//_Accumulate
+
+
+
+/*
+===========
+  _GetWindowSums
+      round( kernelColumns )     column,   .
+         0,     
+===========
+*/
+int LBufferSoftShadow::_GetWindowSums( float column, float kernelColumns, Moments& outSums ) const {
+  const Moments *prefix = this->prefix.data();
+  int width = int( kernelColumns + 0.5f );
+  if( width < 1 ) {
+    width = 1;
+  }
+  if( width >= this->size ) {
+    outSums = prefix[ this->size ];
+    return this->size;
+  }
+  const float start = column - 0.5f * float( width ) + 0.5f;
+  int begin = int( start ),
+      end;
+  if( start < float( begin ) ) {
+    --begin;
+  }
+  if( this->fullCircle ) {
+    if( begin < 0 ) {
+      begin += this->size;
+    } else if( begin >= this->size ) {
+      begin -= this->size;
+    }
+    end = begin + width;
+    if( end > this->size ) {
+      end -= this->size;
+      outSums.sum = prefix[ this->size ].sum - prefix[ begin ].sum + prefix[ end ].sum;
+      outSums.sumSquares = prefix[ this->size ].sumSquares - prefix[ begin ].sumSquares + prefix[ end ].sumSquares;
+      return width;
+    }
+  } else {
+    end = begin + width;
+    if( begin < 0 ) {
+      begin = 0;
+    }
+    if( end > this->size ) {
+      end = this->size;
+    }
+    if( begin >= end ) { //   :  
+      begin = ( begin >= this->size ? this->size - 1 : 0 );
+      end = begin + 1;
+    }
+  }
+  outSums.sum = prefix[ end ].sum - prefix[ begin ].sum;
+  outSums.sumSquares = prefix[ end ].sumSquares - prefix[ begin ].sumSquares;
+  return end - begin;
+}//_GetWindowSums
+
+
+
+/*
+===========
+  GetVisibilityByColumn
+      kernelColumns   column     distance  :
+  1.0,       ,     variance / ( variance + delta^2 )
+===========
+*/
+float LBufferSoftShadow::GetVisibilityByColumn( float column, float distance, float kernelColumns ) const {
+  if( !this->size ) {
+    return 1.0f;
+  }
+  Moments sums;
+  const double invCount = 1.0 / double( this->_GetWindowSums( column, kernelColumns, sums ) );
+  const double mean = double( ( long long ) sums.sum ) * invCount;
+  const double delta = double( distance * this->depthScale ) - mean;
+  if( delta <= 0.0 ) {
+    return 1.0f;
+  }
+  double variance = double( ( long long ) sums.sumSquares ) * invCount - mean * mean;
+  if( variance < this->minVariance ) {
+    variance = this->minVariance;
+  }
+  float visibility = float( variance / ( variance + delta * delta ) );
+  if( this->bleedReduction > 0.0f ) {
+    visibility = max( visibility - this->bleedReduction, 0.0f ) / ( 1.0f - this->bleedReduction );
+  }
+  return visibility;
+}//GetVisibilityByColumn
+
+
+
+float LBufferSoftShadow::GetVisibility( const Vec2& point, float kernelAngle ) const {
+  return this->GetVisibilityByColumn( LBufferPointToTurns( point.x, point.y ) * this->columnsPerTurn, point.Length(), kernelAngle * this->columnsPerTurn * ( 1.0f / Math::TWO_PI ) );
+}//GetVisibility
+
+
+
+float LBufferSoftShadow::GetMeanDepth( float column, float kernelColumns ) const {
+  if( !this->size ) {
+    return 0.0f;
+  }
+  Moments sums;
+  const int count = this->_GetWindowSums( column, kernelColumns, sums );
+  return float( double( ( long long ) sums.sum ) / double( count ) ) / this->depthScale;
+}//GetMeanDepth
@@ -0,0 +1,63 @@
+#ifndef __LBUFFERSOFTSHADOW_H__
+#define __LBUFFERSOFTSHADOW_H__
+
+
+#include <vector>
+#include <emmintrin.h>
+#include "lbuffer.h"
+
+
+const float LBUFFER_SOFT_SHADOW_LEVELS = 65535.0f; //    0..65535   0..lightRadius
+
+
+/*
+    L-   :       
+  (summed-area variance shadow map   ).
+  Build     size ,        
+        ,      .
+     16 ,    64- ,        .
+   Build   :       .
+*/
+class LBufferSoftShadow
+{
+public:
+  LBufferSoftShadow();
+  virtual ~LBufferSoftShadow();
+  void Build( const LBuffer& source );
+  void SetMinVariance( float variance );        //      :   
+  void SetBleedReduction( float amount );       //0..1:  ,       
+  float GetVisibility( const Vec2& point, float kernelAngle ) const; //    ,    
+  float GetVisibilityByColumn( float column, float distance, float kernelColumns ) const;
+  float GetMeanDepth( float column, float kernelColumns ) const;
+  inline int GetSize() const {
+    return this->size;
+  }
+
+private:
+  LBufferSoftShadow( const LBufferSoftShadow& );
+  LBufferSoftShadow& operator=( const LBufferSoftShadow& );
+
+  //        [ 0; x )
+  struct Moments {
+    unsigned long long sum;
+    unsigned long long sumSquares;
+  };
+
+  void _Accumulate( const float *values );
+  void _Accumulate( const unsigned short *codes );
+  static inline void _AddCodes( __m128i codes, __m128i& running, Moments *out ); // 32-    
+  int _GetWindowSums( float column, float kernelColumns, Moments& outSums ) const;
+
+  int size;
+  bool fullCircle;
+  float columnsPerTurn;
+  float depthScale;             //LBUFFER_SOFT_SHADOW_LEVELS / lightRadius
+  float minVariance;            //  
+  float minVarianceDepth;
+  float bleedReduction;
+  std::vector< Moments > prefix; //size + 1 
+  std::vector< float > decoded;  //     
+};
+
+
+#endif
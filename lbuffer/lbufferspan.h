@@ -0,0 +1,324 @@
+#ifndef __LBUFFERSPAN_H__
+#define __LBUFFERSPAN_H__
+
+
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "lbuffercache.h"
+#include "lbufferraytable.h"
+
+
+//,     ,   
+const float LBUFFER_DEPTH_MISS = 1.0e30f;
+
+
+/*
+       ,     :   _mm_sqrt_ps
+   LBuffer::_PointsToPolar,          .
+*/
+inline float LBufferLength( const Vec2& vector ) {
+  return sqrtf( vector.x * vector.x + vector.y * vector.y );
+}//LBufferLength
+
+
+/*
+         point + edge * t, t  [ tMin; tMax ].
+*/
+inline float LBufferGetNearestDistance( const Vec2& point, const Vec2& edge, float tMin, float tMax ) {
+  const float edgeSquare = edge * edge;
+  float t = ( edgeSquare > 0.0f ? -( point * edge ) / edgeSquare : tMin );
+  if( t < tMin ) {
+    t = tMin;
+  } else if( t > tMax ) {
+    t = tMax;
+  }
+  const Vec2 nearest( point.x + edge.x * t, point.y + edge.y * t );
+  return sqrtf( nearest * nearest );
+}//LBufferGetNearestDistance
+
+
+const int LBUFFER_CLIPPED_POINT0 = 1;
+const int LBUFFER_CLIPPED_POINT1 = 2;
+
+/*
+    point0-point1     radius (  LBuffer, StaticLBuffer  LayeredLBuffer).
+       (false).      ,
+   outClipped -    LBUFFER_CLIPPED_*:     .
+  outNearest -       .
+*/
+inline bool LBufferClipSegment( Vec2& point0, Vec2& point1, float radius, float& outNearest, int& outClipped ) {
+  const Vec2 edge( point1 - point0 );
+  outNearest = LBufferGetNearestDistance( point0, edge, 0.0f, 1.0f );
+  outClipped = 0;
+  if( outNearest >= radius ) {
+    return false;
+  }
+  const float radiusSquare = radius * radius;
+  if( point0 * point0 > radiusSquare || point1 * point1 > radiusSquare ) {
+    //   : | point0 + edge * t | = radius
+    const float a = edge * edge,
+                b = point0 * edge,
+                c = point0 * point0 - radiusSquare;
+    const float root = sqrtf( max( b * b - a * c, 0.0f ) );
+    const float t0 = ( -b - root ) / a,
+                t1 = ( -b + root ) / a;
+    const Vec2 origin( point0 );
+    if( t0 > 0.0f ) {
+      point0 = origin + edge * t0;
+      outClipped |= LBUFFER_CLIPPED_POINT0;
+    }
+    if( t1 < 1.0f ) {
+      point1 = origin + edge * t1;
+      outClipped |= LBUFFER_CLIPPED_POINT1;
+    }
+  }
+  return true;
+}//LBufferClipSegment
+
+
+/*
+    ,     (. LBuffer::DrawLine).
+    x: numerator / ( cos[ x ] * edgeY + sin[ x ] * edgeX ),     .
+*/
+struct LBufferLineDepth {
+  float numerator;
+  float edgeX, edgeY;
+  float pointX, pointY;
+  float tMin, tMax;
+  float maxDepth;
+  const float *cos;
+  const float *sin;
+
+  //   ,      radius (. LBufferClipSegment):
+  //    a  numerator / ( cos(a) * edge.y + sin(a) * edge.x )
+  inline void Setup( const Vec2& point0, const Vec2& point1, float radius, const LBufferRayTable& rays ) {
+    const Vec2 edge( point1 - point0 );
+    const float tEpsilon = 0.01f / LBufferLength( edge );
+    this->numerator = point0.x * edge.y - point0.y * edge.x;
+    this->edgeX = edge.x;
+    this->edgeY = edge.y;
+    this->pointX = point0.x;
+    this->pointY = point0.y;
+    this->tMin = -tEpsilon;
+    this->tMax = 1.0f + tEpsilon;
+    this->maxDepth = radius * 2.0f;
+    this->cos = rays.GetCos();
+    this->sin = rays.GetSin();
+  }
+
+  inline float Scalar( int x ) const {
+    float denominator = this->cos[ x ] * this->edgeY + this->sin[ x ] * this->edgeX;
+    float invDenominator = 1.0f / denominator;
+    float depth = this->numerator * invDenominator;
+    float t = -( this->pointX * this->sin[ x ] + this->pointY * this->cos[ x ] ) * invDenominator;
+    return ( t >= this->tMin && t <= this->tMax && depth >= 0.0f && depth <= this->maxDepth ) ? depth : LBUFFER_DEPTH_MISS;
+  }
+
+  inline __m128 Sse( int x ) const {
+    __m128 c = _mm_loadu_ps( this->cos + x ), s = _mm_loadu_ps( this->sin + x );
+    __m128 invDenominator = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_add_ps( _mm_mul_ps( c, _mm_set1_ps( this->edgeY ) ), _mm_mul_ps( s, _mm_set1_ps( this->edgeX ) ) ) );
+    __m128 depth = _mm_mul_ps( _mm_set1_ps( this->numerator ), invDenominator );
+    __m128 t = _mm_mul_ps( _mm_add_ps( _mm_mul_ps( s, _mm_set1_ps( -this->pointX ) ), _mm_mul_ps( c, _mm_set1_ps( -this->pointY ) ) ), invDenominator );
+    __m128 valid = _mm_and_ps(
+      _mm_and_ps( _mm_cmpge_ps( t, _mm_set1_ps( this->tMin ) ), _mm_cmple_ps( t, _mm_set1_ps( this->tMax ) ) ),
+      _mm_and_ps( _mm_cmpge_ps( depth, _mm_setzero_ps() ), _mm_cmple_ps( depth, _mm_set1_ps( this->maxDepth ) ) )
+    );
+    return _mm_or_ps( _mm_and_ps( valid, depth ), _mm_andnot_ps( valid, _mm_set1_ps( LBUFFER_DEPTH_MISS ) ) );
+  }
+
+#ifdef __AVX2__
+  inline __m256 Avx( int x ) const {
+    __m256 c = _mm256_loadu_ps( this->cos + x ), s = _mm256_loadu_ps( this->sin + x );
+    __m256 invDenominator = _mm256_div_ps( _mm256_set1_ps( 1.0f ), _mm256_add_ps( _mm256_mul_ps( c, _mm256_set1_ps( this->edgeY ) ), _mm256_mul_ps( s, _mm256_set1_ps( this->edgeX ) ) ) );
+    __m256 depth = _mm256_mul_ps( _mm256_set1_ps( this->numerator ), invDenominator );
+    __m256 t = _mm256_mul_ps( _mm256_add_ps( _mm256_mul_ps( s, _mm256_set1_ps( -this->pointX ) ), _mm256_mul_ps( c, _mm256_set1_ps( -this->pointY ) ) ), invDenominator );
+    __m256 valid = _mm256_and_ps(
+      _mm256_and_ps( _mm256_cmp_ps( t, _mm256_set1_ps( this->tMin ), _CMP_GE_OQ ), _mm256_cmp_ps( t, _mm256_set1_ps( this->tMax ), _CMP_LE_OQ ) ),
+      _mm256_and_ps( _mm256_cmp_ps( depth, _mm256_setzero_ps(), _CMP_GE_OQ ), _mm256_cmp_ps( depth, _mm256_set1_ps( this->maxDepth ), _CMP_LE_OQ ) )
+    );
+    return _mm256_blendv_ps( _mm256_set1_ps( LBUFFER_DEPTH_MISS ), depth, valid );
+  }
+#endif
+};
+
+
+/*
+     : base + slope * ( x - origin ) (. LBuffer::DrawPolarLine).
+*/
+struct LBufferLinearDepth {
+  float base;
+  float slope;
+  int origin;
+
+  inline float Scalar( int x ) const {
+    return this->base + this->slope * float( x - this->origin );
+  }
+
+  inline __m128 Sse( int x ) const {
+    __m128 offset = _mm_add_ps( _mm_set1_ps( float( x - this->origin ) ), _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f ) );
+    return _mm_add_ps( _mm_set1_ps( this->base ), _mm_mul_ps( _mm_set1_ps( this->slope ), offset ) );
+  }
+
+#ifdef __AVX2__
+  inline __m256 Avx( int x ) const {
+    __m256 offset = _mm256_add_ps( _mm256_set1_ps( float( x - this->origin ) ), _mm256_set_ps( 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f ) );
+    return _mm256_add_ps( _mm256_set1_ps( this->base ), _mm256_mul_ps( _mm256_set1_ps( this->slope ), offset ) );
+  }
+#endif
+};
+
+
+/*
+         [ begin; end ) :
+    ,    .
+    out,       (    end - begin ),
+    .
+*/
+template< class Generator >
+inline int LBufferWriteSpan( float *buffer, int begin, int end, const Generator &generator, LBufferCacheEntity::Value *out = NULL ) {
+  LBufferCacheEntity::Value *outBegin = out;
+  int x = begin;
+
+#ifdef __AVX2__
+  const __m256 zero8 = _mm256_setzero_ps(), miss8 = _mm256_set1_ps( LBUFFER_DEPTH_MISS );
+  for( ; x + 8 <= end; x += 8 ) {
+    __m256 depth = _mm256_max_ps( generator.Avx( x ), zero8 );
+    _mm256_storeu_ps( buffer + x, _mm256_min_ps( depth, _mm256_loadu_ps( buffer + x ) ) );
+    if( out ) {
+      int mask = _mm256_movemask_ps( _mm256_cmp_ps( depth, miss8, _CMP_LT_OQ ) );
+      if( mask == 0xFF ) {
+        __m256 index = _mm256_castsi256_ps( _mm256_add_epi32( _mm256_set1_epi32( x ), _mm256_set_epi32( 7, 6, 5, 4, 3, 2, 1, 0 ) ) );
+        __m256 low = _mm256_unpacklo_ps( index, depth ), high = _mm256_unpackhi_ps( index, depth );
+        _mm256_storeu_ps( reinterpret_cast< float* >( out ), _mm256_permute2f128_ps( low, high, 0x20 ) );
+        _mm256_storeu_ps( reinterpret_cast< float* >( out + 4 ), _mm256_permute2f128_ps( low, high, 0x31 ) );
+        out += 8;
+      } else if( mask ) {
+        float values[ 8 ];
+        _mm256_storeu_ps( values, depth );
+        for( int q = 0; q < 8; ++q ) {
+          if( mask & ( 1 << q ) ) {
+            *out++ = LBufferCacheEntity::Value( x + q, values[ q ] );
+          }
+        }
+      }
+    }
+  }
+#endif
+
+  const __m128 zero = _mm_setzero_ps(), miss = _mm_set1_ps( LBUFFER_DEPTH_MISS );
+  for( ; x + 4 <= end; x += 4 ) {
+    __m128 depth = _mm_max_ps( generator.Sse( x ), zero );
+    _mm_storeu_ps( buffer + x, _mm_min_ps( depth, _mm_loadu_ps( buffer + x ) ) );
+    if( out ) {
+      int mask = _mm_movemask_ps( _mm_cmplt_ps( depth, miss ) );
+      if( mask == 0xF ) {
+        __m128 index = _mm_castsi128_ps( _mm_add_epi32( _mm_set1_epi32( x ), _mm_set_epi32( 3, 2, 1, 0 ) ) );
+        _mm_storeu_ps( reinterpret_cast< float* >( out ), _mm_unpacklo_ps( index, depth ) );
+        _mm_storeu_ps( reinterpret_cast< float* >( out + 2 ), _mm_unpackhi_ps( index, depth ) );
+        out += 4;
+      } else if( mask ) {
+        float values[ 4 ];
+        _mm_storeu_ps( values, depth );
+        for( int q = 0; q < 4; ++q ) {
+          if( mask & ( 1 << q ) ) {
+            *out++ = LBufferCacheEntity::Value( x + q, values[ q ] );
+          }
+        }
+      }
+    }
+  }
+
+  for( ; x < end; ++x ) {
+    float depth = generator.Scalar( x );
+    if( depth < 0.0f ) {
+      depth = 0.0f;
+    }
+    if( depth < buffer[ x ] ) {
+      buffer[ x ] = depth;
+    }
+    if( out && depth < LBUFFER_DEPTH_MISS ) {
+      *out++ = LBufferCacheEntity::Value( x, depth );
+    }
+  }
+  return int( out - outBegin );
+}//LBufferWriteSpan
+
+
+/*
+         ( LBuffer::BeginConcurrent).
+      ,    float        ,
+         .
+      memcpy:  float    int  strict aliasing.
+*/
+inline void LBufferAtomicMin( float *address, float value ) {
+  int bits;
+  memcpy( &bits, &value, sizeof( bits ) );
+#ifdef _MSC_VER
+  volatile long *target = reinterpret_cast< volatile long* >( address );
+  long current = *target;
+  while( bits < current ) {
+    const long previous = _InterlockedCompareExchange( target, bits, current );
+    if( previous == current ) {
+      break;
+    }
+    current = previous;
+  }
+#else
+  int *target = reinterpret_cast< int* >( address );
+  int current = __atomic_load_n( target, __ATOMIC_RELAXED );
+  while( bits < current && !__atomic_compare_exchange_n( target, &current, bits, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) ) {
+  }
+#endif
+}//LBufferAtomicMin
+
+
+/*
+   ,  LBufferWriteSpan,  ,      :
+      ,          .
+*/
+template< class Generator >
+inline int LBufferWriteSpanAtomic( float *buffer, int begin, int end, const Generator &generator, LBufferCacheEntity::Value *out = NULL ) {
+  LBufferCacheEntity::Value *outBegin = out;
+  int x = begin;
+  const __m128 zero = _mm_setzero_ps(), miss = _mm_set1_ps( LBUFFER_DEPTH_MISS );
+  for( ; x + 4 <= end; x += 4 ) {
+    __m128 depth = _mm_max_ps( generator.Sse( x ), zero );
+    int mask = _mm_movemask_ps( _mm_cmplt_ps( depth, miss ) );
+    if( !mask ) {
+      continue;
+    }
+    float values[ 4 ];
+    _mm_storeu_ps( values, depth );
+    for( int q = 0; q < 4; ++q ) {
+      if( mask & ( 1 << q ) ) {
+        LBufferAtomicMin( buffer + x + q, values[ q ] );
+        if( out ) {
+          *out++ = LBufferCacheEntity::Value( x + q, values[ q ] );
+        }
+      }
+    }
+  }
+  for( ; x < end; ++x ) {
+    float depth = generator.Scalar( x );
+    if( depth < 0.0f ) {
+      depth = 0.0f;
+    }
+    if( depth < LBUFFER_DEPTH_MISS ) {
+      LBufferAtomicMin( buffer + x, depth );
+      if( out ) {
+        *out++ = LBufferCacheEntity::Value( x, depth );
+      }
+    }
+  }
+  return int( out - outBegin );
+}//LBufferWriteSpanAtomic
+
+
+#endif
@@ -0,0 +1,300 @@
+#ifndef __LBUFFERSTATIC_H__
+#define __LBUFFERSTATIC_H__
+
+
+#include <array>
+#include <atomic>
+#include <emmintrin.h>
+#include "lib/klib.h"
+#include "lbufferraytable.h"
+#include "lbufferangle.h"
+#include "lbufferspan.h"
+
+
+const float LBUFFER_STATIC_TWO_PI = 6.28318530717958647692f;
+const float LBUFFER_STATIC_INV_TWO_PI = 0.15915494309189533577f;
+
+
+/*
+          :     ,
+  Count -   .
+*/
+template< int Count >
+struct LBufferUnrolled {
+  static inline void Fill( float *buffer, __m128 value ) {
+    _mm_storeu_ps( buffer, value );
+    LBufferUnrolled< Count - 4 >::Fill( buffer + 4, value );
+  }
+
+  static inline void Min( float *buffer, const float *source ) {
+    _mm_storeu_ps( buffer, _mm_min_ps( _mm_loadu_ps( buffer ), _mm_loadu_ps( source ) ) );
+    LBufferUnrolled< Count - 4 >::Min( buffer + 4, source + 4 );
+  }
+};
+
+template<>
+struct LBufferUnrolled< 0 > {
+  static inline void Fill( float*, __m128 ) {
+  }
+
+  static inline void Min( float*, const float* ) {
+  }
+};
+
+
+/*
+   ,    StaticLBuffer< Size >:      
+      ,        .
+        ,   
+       ;      
+       .
+*/
+template< int Size >
+struct LBufferStaticRays {
+  static std::atomic< const LBufferRayTable* > table;
+
+  static inline const LBufferRayTable& Get() {
+    const LBufferRayTable *rays = table.load( std::memory_order_acquire );
+    if( !rays ) {
+      rays = LBufferRayTable::AcquirePermanent( Size, LBUFFER_STATIC_TWO_PI );
+      table.store( rays, std::memory_order_release );
+    }
+    return *rays;
+  }
+};
+
+template< int Size >
+std::atomic< const LBufferRayTable* > LBufferStaticRays< Size >::table;
+
+
+/*
+  L-    ,    (   ).
+     ,   ;     
+     -   .  x    2pi * x / Size,
+     LBuffer( Size, 2pi )   LBUFFER_STORAGE_FLOAT.
+  Size  .
+*/
+template< int Size >
+class StaticLBuffer
+{
+public:
+  enum {
+    SIZE = Size,
+    SIZE_MASK = ( Size & ( Size - 1 ) ) ? 0 : Size - 1, //Size - 1  Size -  ,  0
+  };
+
+  StaticLBuffer();
+  void Clear( float value );
+  void Merge( const StaticLBuffer& other );
+  void DrawLine( const Vec2& point0, const Vec2& point1 );
+  void DrawPolygon( const Vec2 *points, int count );
+  inline float FloatToSize( float value ) const {
+    return value * ( float( Size ) * LBUFFER_STATIC_INV_TWO_PI );
+  }
+  inline float SizeToFloat( int value ) const {
+    return float( value ) * ( LBUFFER_STATIC_TWO_PI / float( Size ) );
+  }
+  float GetValue( float x ) const;
+  float GetValueByIndex( int index ) const;
+  inline int GetSize() const {
+    return Size;
+  }
+  inline float GetColumnOfPoint( const Vec2& point ) const {
+    return LBufferPointToTurns( point.x, point.y ) * float( Size );
+  }
+  inline int GetColumnOfAngle( LBufferAngle angle ) const {
+    return int( this->_AngleToColumnFixed( angle ) >> 32 );
+  }
+  inline const float* GetData() const {
+    return this->buffer.data();
+  }
+
+private:
+  static_assert( Size > 0 && Size % 4 == 0, "StaticLBuffer: Size must be a positive multiple of 4" );
+
+  void _PushValue( int position, float value );
+  void _DrawSegment( const Vec2& point0, const Vec2& point1, LBufferAngle angle0, LBufferAngle angle1 );
+  //   ,  32.32:        
+  static inline long long _AngleToColumnFixed( LBufferAngle angle ) {
+    return ( long long ) ( ( unsigned long long ) angle * ( unsigned long long ) Size );
+  }
+  static inline int _Wrap( int position ) {
+    if( SIZE_MASK != 0 ) {
+      return position & SIZE_MASK;
+    }
+    position %= Size;
+    return position < 0 ? position + Size : position;
+  }
+
+  std::array< float, Size > buffer;
+  float lightRadius;
+};
+
+
+
+template< int Size >
+StaticLBuffer< Size >::StaticLBuffer()
+  :lightRadius( 1000.0f )
+{
+  LBufferUnrolled< Size >::Fill( this->buffer.data(), _mm_set1_ps( this->lightRadius ) );
+}
+
+
+
+template< int Size >
+void StaticLBuffer< Size >::Clear( float value ) {
+  this->lightRadius = value;
+  LBufferUnrolled< Size >::Fill( this->buffer.data(), _mm_set1_ps( value ) );
+}//Clear
+
+
+
+/*
+===========
+  Merge
+        :      
+===========
+*/
+template< int Size >
+void StaticLBuffer< Size >::Merge( const StaticLBuffer& other ) {
+  LBufferUnrolled< Size >::Min( this->buffer.data(), other.buffer.data() );
+}//Merge
+
+
+
+/*
+===========
+  DrawLine
+   ,    
+===========
+*/
+template< int Size >
+void StaticLBuffer< Size >::DrawLine( const Vec2& point0, const Vec2& point1 ) {
+  this->_DrawSegment( point0, point1, LBufferPointToAngle( point0.x, point0.y ), LBufferPointToAngle( point1.x, point1.y ) );
+}//DrawLine
+
+
+
+/*
+===========
+  DrawPolygon
+      count 
+===========
+*/
+template< int Size >
+void StaticLBuffer< Size >::DrawPolygon( const Vec2 *points, int count ) {
+  if( count < 2 ) {
+    return;
+  }
+  LBufferAngle anglePrev = LBufferPointToAngle( points[ count - 1 ].x, points[ count - 1 ].y );
+  for( int q = 0, prev = count - 1; q < count; prev = q++ ) {
+    LBufferAngle angle = LBufferPointToAngle( points[ q ].x, points[ q ].y );
+    this->_DrawSegment( points[ prev ], points[ q ], anglePrev, angle );
+    anglePrev = angle;
+  }
+}//DrawPolygon
+
+
+
+template< int Size >
+void StaticLBuffer< Size >::_PushValue( int position, float value ) {
+  position = _Wrap( position );
+  if( value < 0.0f ) {
+    value = 0.0f;
+  }
+  if( value < this->buffer[ position ] ) {
+    this->buffer[ position ] = value;
+  }
+}//_PushValue
+
+
+
+/*
+===========
+  _DrawSegment
+   ,  LBuffer::_DrawSegment,   :     ,
+      0    
+===========
+*/
+template< int Size >
+void StaticLBuffer< Size >::_DrawSegment( const Vec2& segment0, const Vec2& segment1, LBufferAngle angle0, LBufferAngle angle1 ) {
+  Vec2 point0( segment0 ),
+       point1( segment1 );
+  float nearest;
+  int clipped;
+  if( !LBufferClipSegment( point0, point1, this->lightRadius, nearest, clipped ) ) {
+    return;
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT0 ) {
+    angle0 = LBufferPointToAngle( point0.x, point0.y );
+  }
+  if( clipped & LBUFFER_CLIPPED_POINT1 ) {
+    angle1 = LBufferPointToAngle( point1.x, point1.y );
+  }
+
+  LBufferAngle angleBegin = angle0,
+               angleEnd = angle1;
+  const float side = point0.x * point1.y - point0.y * point1.x;
+  if( side > 0.0f ) {
+    Math::Swap( angleBegin, angleEnd );
+  } else if( side == 0.0f && point0 * point1 < 0.0f ) { //   
+    this->_PushValue( this->GetColumnOfAngle( angleBegin ), 0.0f );
+    this->_PushValue( this->GetColumnOfAngle( angleEnd ), 0.0f );
+    return;
+  }
+  LBufferAngle arc = angleEnd - angleBegin;
+  if( arc > LBUFFER_ANGLE_HALF + LBUFFER_ANGLE_QUARTER ) { //  
+    arc = 0;
+  }
+  const long long fixedBegin = _AngleToColumnFixed( angleBegin );
+  const long long fixedEnd = fixedBegin + _AngleToColumnFixed( arc );
+
+  if( ( fixedBegin >> 32 ) == ( fixedEnd >> 32 ) ) { // :   
+    this->_PushValue( int( fixedBegin >> 32 ), min( LBufferLength( point0 ), LBufferLength( point1 ) ) );
+    return;
+  }
+
+  const long long error = _AngleToColumnFixed( LBUFFER_ANGLE_MAX_ERROR_BINARY );
+  const long long low = fixedBegin - error,
+                  high = fixedEnd + error;
+  int begin = int( ( low + ( 1LL << 32 ) - 1 ) >> 32 ),
+      count = int( high >> 32 ) - begin + 1;
+  if( count > Size ) {
+    count = Size;
+  }
+  begin = _Wrap( begin );
+
+  LBufferLineDepth generator;
+  generator.Setup( point0, point1, this->lightRadius, LBufferStaticRays< Size >::Get() );
+
+  if( begin + count <= Size ) {
+    LBufferWriteSpan( this->buffer.data(), begin, begin + count, generator );
+  } else {
+    LBufferWriteSpan( this->buffer.data(), begin, Size, generator );
+    LBufferWriteSpan( this->buffer.data(), 0, begin + count - Size, generator );
+  }
+}//_DrawSegment
+
+
+
+template< int Size >
+float StaticLBuffer< Size >::GetValue( float x ) const {
+  if( x < 0.0f || x > LBUFFER_STATIC_TWO_PI ) {
+    return 0.0f;
+  }
+  int index = int( this->FloatToSize( x ) );
+  return this->buffer[ index < Size ? index : Size - 1 ];
+}//GetValue
+
+
+
+template< int Size >
+float StaticLBuffer< Size >::GetValueByIndex( int index ) const {
+  if( index < 0 || index >= Size ) {
+    return this->buffer[ 0 ];
+  }
+  return this->buffer[ index ];
+}//GetValueByIndex
+
+
+#endif
@@ -0,0 +1,12 @@
+#include "lbufferstorage.h"
+
+
+const LBufferLog8Table LBufferLog8Encoder::unitDecodeTable;
+
+
+LBufferLog8Table::LBufferLog8Table() {
+  const double step = log( double( LBUFFER_LOG8_RANGE ) ) / 255.0;
+  for( int code = 0; code < 256; ++code ) {
+    this->values[ code ] = float( ( exp( double( code ) * step ) - 1.0 ) / ( double( LBUFFER_LOG8_RANGE ) - 1.0 ) );
+  }
+}
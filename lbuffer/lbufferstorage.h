@@ -0,0 +1,165 @@
+#ifndef __LBUFFERSTORAGE_H__
+#define __LBUFFERSTORAGE_H__
+
+
+#include <math.h>
+#include <emmintrin.h>
+#include "lbuffercache.h"
+#include "lbufferspan.h"
+
+
+/*
+      L-.
+      ,       .
+  lightRadius -   Clear.
+*/
+enum LBufferStorage {
+  LBUFFER_STORAGE_FLOAT,      //fp32, 4 :  
+  LBUFFER_STORAGE_HALF,       //fp16, 2 :     2^-11 (0.05%),   65504 
+  LBUFFER_STORAGE_UINT16,     // uint16  0  lightRadius, 2 :     lightRadius / 128000 (    float)
+  LBUFFER_STORAGE_UINT8_LOG,  // uint8  0  lightRadius, 1 :    0.014 * ( depth + lightRadius / 1023 )
+};
+//     lightRadius   lightRadius
+
+
+const float LBUFFER_LOG8_RANGE = 1024.0f; //       
+
+
+struct LBufferHalfEncoder {
+  typedef unsigned short Code;
+
+  inline Code Encode( float value ) const {
+    if( value >= 65504.0f ) {
+      return 0x7BFF;
+    }
+    if( value < 6.103515625e-05f ) { //  fp16
+      return Code( int( value * 16777216.0f + 0.5f ) );
+    }
+    union {
+      float f;
+      unsigned int i;
+    } bits;
+    bits.f = value;
+    unsigned int i = bits.i + 0x00000FFF + ( ( bits.i >> 13 ) & 1 );
+    return Code( ( i - 0x38000000 ) >> 13 );
+  }
+
+  inline float Decode( Code code ) const {
+    if( code < 0x0400 ) {
+      return float( code ) * 5.9604644775390625e-08f;
+    }
+    union {
+      float f;
+      unsigned int i;
+    } bits;
+    bits.i = ( ( unsigned int ) code << 13 ) + 0x38000000;
+    return bits.f;
+  }
+};
+
+
+struct LBufferLinear16Encoder {
+  typedef unsigned short Code;
+  float scale;
+  float invScale;
+
+  LBufferLinear16Encoder( float range )
+    :scale( 65535.0f / range ), invScale( range / 65535.0f ) {
+  }
+
+  inline Code Encode( float value ) const {
+    float code = value * this->scale + 0.5f;
+    return code >= 65535.0f ? 0xFFFF : Code( int( code ) );
+  }
+
+  inline float Decode( Code code ) const {
+    return float( code ) * this->invScale;
+  }
+};
+
+
+//   LBUFFER_STORAGE_UINT8_LOG   1.0,    
+struct LBufferLog8Table {
+  float values[ 256 ];
+
+  LBufferLog8Table();
+};
+
+
+struct LBufferLog8Encoder {
+  typedef unsigned char Code;
+  float range;
+  float scale;      //( LBUFFER_LOG8_RANGE - 1 ) / range
+  float invStep;    //255 / ln( LBUFFER_LOG8_RANGE )
+  const float *decodeTable;
+
+  LBufferLog8Encoder( float setRange )
+    :range( setRange ), scale( ( LBUFFER_LOG8_RANGE - 1.0f ) / setRange ), invStep( 255.0f / logf( LBUFFER_LOG8_RANGE ) ), decodeTable( unitDecodeTable.values ) {
+  }
+
+  inline Code Encode( float value ) const {
+    float code = logf( 1.0f + value * this->scale ) * this->invStep + 0.5f;
+    return code >= 255.0f ? 0xFF : Code( int( code ) );
+  }
+
+  inline float Decode( Code code ) const {
+    return this->decodeTable[ code ] * this->range;
+  }
+
+  //    lbufferstorage.cpp,   :
+  // static    VS2013   
+  static const LBufferLog8Table unitDecodeTable;
+};
+
+
+/*
+          (. LBufferWriteSpan):
+    ,    -  .
+*/
+template< class Encoder, class Generator >
+inline int LBufferWriteSpanEncoded( typename Encoder::Code *buffer, int begin, int end, const Encoder &encoder, const Generator &generator, LBufferCacheEntity::Value *out = NULL ) {
+  LBufferCacheEntity::Value *outBegin = out;
+  float depth[ 4 ];
+  int x = begin;
+  while( x < end ) {
+    int count = end - x;
+    if( count >= 4 ) {
+      _mm_storeu_ps( depth, _mm_max_ps( generator.Sse( x ), _mm_setzero_ps() ) );
+      count = 4;
+    } else {
+      depth[ 0 ] = generator.Scalar( x );
+      if( depth[ 0 ] < 0.0f ) {
+        depth[ 0 ] = 0.0f;
+      }
+      count = 1;
+    }
+    for( int q = 0; q < count; ++q, ++x ) {
+      if( depth[ q ] >= LBUFFER_DEPTH_MISS ) {
+        continue;
+      }
+      typename Encoder::Code code = encoder.Encode( depth[ q ] );
+      if( code < buffer[ x ] ) {
+        buffer[ x ] = code;
+      }
+      if( out ) {
+        *out++ = LBufferCacheEntity::Value( x, depth[ q ] );
+      }
+    }
+  }
+  return int( out - outBegin );
+}//LBufferWriteSpanEncoded
+
+
+// count        
+template< class Encoder >
+inline void LBufferWriteValuesEncoded( typename Encoder::Code *buffer, const Encoder &encoder, const LBufferCacheEntity::Value *values, int count ) {
+  for( int q = 0; q < count; ++q ) {
+    typename Encoder::Code code = encoder.Encode( values[ q ].value );
+    if( code < buffer[ values[ q ].index ] ) {
+      buffer[ values[ q ].index ] = code;
+    }
+  }
+}//LBufferWriteValuesEncoded
+
+
+#endif
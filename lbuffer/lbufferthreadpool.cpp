@@ -0,0 +1,182 @@
+#include "lbufferthreadpool.h"
+#include <chrono>
+
+
+static inline double LBufferThreadPoolNow() {
+  return std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+float LBufferThreadPoolStats::GetUtilization() const {
+  if( this->wallTime <= 0.0 || this->busyTime.empty() ) {
+    return 1.0f;
+  }
+  double busy = 0.0;
+  for( auto &time: this->busyTime ) {
+    busy += time;
+  }
+  return float( busy / ( this->wallTime * double( this->busyTime.size() ) ) );
+}//GetUtilization
+
+
+LBufferThreadPool::LBufferThreadPool( int setThreadCount )
+  :job( NULL ), activeWorkers( 0 ), generation( 0 ), stopping( false )
+{
+  if( setThreadCount <= 0 ) {
+    setThreadCount = int( std::thread::hardware_concurrency() );
+    if( setThreadCount < 1 ) {
+      setThreadCount = 1;
+    }
+  }
+  for( int q = 0; q < setThreadCount; ++q ) {
+    this->queues.push_back( new JobQueue() );
+  }
+  this->stats.wallTime = 0.0;
+  this->stats.busyTime.assign( setThreadCount, 0.0 );
+  this->stats.jobs.assign( setThreadCount, 0 );
+  this->stats.steals.assign( setThreadCount, 0 );
+  for( int q = 1; q < setThreadCount; ++q ) {
+    this->workers.push_back( std::thread( &LBufferThreadPool::_WorkerLoop, this, q ) );
+  }
+}
+
+
+LBufferThreadPool::~LBufferThreadPool() {
+  {
+    std::lock_guard< std::mutex > lock( this->mutex );
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for( auto &worker: this->workers ) {
+    worker.join();
+  }
+  for( auto &queue: this->queues ) {
+    delete queue;
+  }
+}
+
+
+/*
+===========
+  Run
+    ,    
+===========
+*/
+void LBufferThreadPool::Run( int jobCount, const Job& job ) {
+  const double startTime = LBufferThreadPoolNow();
+  const int threadCount = this->GetThreadCount();
+  for( int q = 0; q < threadCount; ++q ) {
+    this->stats.busyTime[ q ] = 0.0;
+    this->stats.jobs[ q ] = 0;
+    this->stats.steals[ q ] = 0;
+  }
+  if( jobCount <= 0 ) {
+    this->stats.wallTime = 0.0;
+    return;
+  }
+  if( this->workers.empty() || jobCount == 1 ) {
+    for( int q = 0; q < jobCount; ++q ) {
+      job( q );
+    }
+    this->stats.wallTime = this->stats.busyTime[ 0 ] = LBufferThreadPoolNow() - startTime;
+    this->stats.jobs[ 0 ] = jobCount;
+    return;
+  }
+  for( int thread = 0; thread < threadCount; ++thread ) { //       
+    JobQueue &queue = *this->queues[ thread ];
+    for( int q = jobCount * thread / threadCount, end = jobCount * ( thread + 1 ) / threadCount; q < end; ++q ) {
+      queue.jobs.push_back( q );
+    }
+  }
+  {
+    std::lock_guard< std::mutex > lock( this->mutex );
+    this->job = &job;
+    this->activeWorkers = int( this->workers.size() );
+    ++this->generation;
+  }
+  this->wake.notify_all();
+  this->_RunJobs( 0 );
+  std::unique_lock< std::mutex > lock( this->mutex );
+  while( this->activeWorkers ) {
+    this->done.wait( lock );
+  }
+  this->job = NULL;
+  this->stats.wallTime = LBufferThreadPoolNow() - startTime;
+}//Run
+
+
+/*
+===========
+  _RunJobs
+     ,  ;       ,
+            
+===========
+*/
+void LBufferThreadPool::_RunJobs( int thread ) {
+  int jobIndex;
+  while( true ) {
+    bool stolen = false;
+    if( !this->_PopJob( thread, jobIndex ) ) {
+      if( !this->_StealJob( thread, jobIndex ) ) {
+        break;
+      }
+      stolen = true;
+    }
+    const double startTime = LBufferThreadPoolNow();
+    ( *this->job )( jobIndex );
+    this->stats.busyTime[ thread ] += LBufferThreadPoolNow() - startTime;
+    ++this->stats.jobs[ thread ];
+    if( stolen ) {
+      ++this->stats.steals[ thread ];
+    }
+  }
+}//_RunJobs
+
+
+bool LBufferThreadPool::_PopJob( int thread, int& outJob ) {
+  JobQueue &queue = *this->queues[ thread ];
+  std::lock_guard< std::mutex > lock( queue.mutex );
+  if( queue.jobs.empty() ) {
+    return false;
+  }
+  outJob = queue.jobs.back();
+  queue.jobs.pop_back();
+  return true;
+}//_PopJob
+
+
+bool LBufferThreadPool::_StealJob( int thread, int& outJob ) {
+  const int threadCount = int( this->queues.size() );
+  for( int q = 1; q < threadCount; ++q ) {
+    JobQueue &queue = *this->queues[ ( thread + q ) % threadCount ];
+    std::lock_guard< std::mutex > lock( queue.mutex );
+    if( !queue.jobs.empty() ) {
+      outJob = queue.jobs.front();
+      queue.jobs.pop_front();
+      return true;
+    }
+  }
+  return false;
+}//_StealJob
+
+
+void LBufferThreadPool::_WorkerLoop( int thread ) {
+  unsigned int seenGeneration = 0;
+  while( true ) {
+    {
+      std::unique_lock< std::mutex > lock( this->mutex );
+      while( !this->stopping && this->generation == seenGeneration ) {
+        this->wake.wait( lock );
+      }
+      if( this->stopping ) {
+        return;
+      }
+      seenGeneration = this->generation;
+    }
+    this->_RunJobs( thread );
+    std::lock_guard< std::mutex > lock( this->mutex );
+    if( !--this->activeWorkers ) {
+      this->done.notify_one();
+    }
+  }
+}//_WorkerLoop
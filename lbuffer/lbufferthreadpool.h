@@ -0,0 +1,76 @@
+#ifndef __LBUFFERTHREADPOOL_H__
+#define __LBUFFERTHREADPOOL_H__
+
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+
+//     
+struct LBufferThreadPoolStats {
+  double wallTime;                  // Run, 
+  std::vector< double > busyTime;   //    ,  (0 -  )
+  std::vector< int > jobs;          //   
+  std::vector< int > steals;        //     
+
+  // ,     : 1.0 -  
+  float GetUtilization() const;
+};
+
+
+/*
+         L-.
+  Run( jobCount, job )  job( 0 ) ... job( jobCount - 1 )      
+   ,    .
+        ;       ,
+   ,     ,    (  )
+    .
+  Run  :     .
+*/
+class LBufferThreadPool
+{
+public:
+  typedef std::function< void( int ) > Job;
+
+  LBufferThreadPool( int setThreadCount = 0 ); //    , 0 -   
+  virtual ~LBufferThreadPool();
+  void Run( int jobCount, const Job& job );
+  inline int GetThreadCount() const {
+    return int( this->workers.size() ) + 1;
+  }
+  inline const LBufferThreadPoolStats& GetStats() const {
+    return this->stats;
+  }
+
+private:
+  LBufferThreadPool( const LBufferThreadPool& );
+  LBufferThreadPool& operator=( const LBufferThreadPool& );
+
+  struct JobQueue {
+    std::mutex mutex;
+    std::deque< int > jobs;
+  };
+
+  void _WorkerLoop( int thread );
+  void _RunJobs( int thread );
+  bool _PopJob( int thread, int& outJob );
+  bool _StealJob( int thread, int& outJob );
+
+  std::vector< std::thread > workers;
+  std::vector< JobQueue* > queues;  //   , 0 -  
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  const Job *job;
+  int activeWorkers;                // ,     
+  unsigned int generation;          // ,      
+  bool stopping;
+  LBufferThreadPoolStats stats;
+};
+
+
+#endif
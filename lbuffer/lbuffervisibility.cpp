@@ -0,0 +1,227 @@
+#include "lbuffervisibility.h"
+#include <math.h>
+#include <algorithm>
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+//   , word != 0
+static inline int LBufferLowestBit( unsigned int word ) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward( &index, word );
+  return int( index );
+#else
+  return __builtin_ctz( word );
+#endif
+}//LBufferLowestBit
+
+
+// 
+static inline LBufferVisibilityRect LBufferVisibilityEmptyRect() {
+  LBufferVisibilityRect rect;
+  rect.x0 = rect.x1 = rect.y0 = rect.y1 = 0;
+  rect.width = 0;
+  return rect;
+}//LBufferVisibilityEmptyRect
+
+
+LBufferVisibilitySet::LBufferVisibilitySet()
+  :count( 0 )
+{
+  this->_Resize( 0 );
+}
+
+
+LBufferVisibilitySet::~LBufferVisibilitySet() {
+}
+
+
+void LBufferVisibilitySet::Reset() {
+  this->_Resize( this->count );
+  this->changed.clear();
+}//Reset
+
+
+void LBufferVisibilitySet::_Resize( int setCount ) {
+  this->count = setCount;
+  const size_t words = ( ( size_t( setCount ) + 31 ) / 32 + 3 ) / 4 * 4 + 4;
+  this->bits.assign( words, 0 );
+  this->previous.assign( words, 0 );
+  this->active = this->previousActive = LBufferVisibilityEmptyRect();
+}//_Resize
+
+
+
+/*
+===========
+  _BeginUpdate
+     ,      ,    
+===========
+*/
+void LBufferVisibilitySet::_BeginUpdate( int setCount ) {
+  if( setCount != this->count ) {
+    this->_Resize( setCount );
+  }
+  this->bits.swap( this->previous );
+  std::swap( this->active, this->previousActive );
+  for( int y = this->active.y0; y < this->active.y1; ++y ) {
+    std::fill( this->bits.begin() + _GetRowWordBegin( this->active, y ), this->bits.begin() + _GetRowWordEnd( this->active, y ), 0u );
+  }
+  this->active = LBufferVisibilityEmptyRect();
+  this->changed.clear();
+}//_BeginUpdate
+
+
+
+/*
+===========
+  _QueryBatch
+   batchCount   points     first ... first + batchCount - 1:
+     16         
+===========
+*/
+void LBufferVisibilitySet::_QueryBatch( const LBuffer& buffer, int first, int batchCount ) {
+  buffer.QueryVisibility( this->points, batchCount, this->lit, false );
+  const __m128i zero = _mm_setzero_si128();
+  for( int q = 0; q < batchCount; q += 16 ) {
+    unsigned int mask = ( unsigned int ) _mm_movemask_epi8( _mm_sub_epi8( zero, _mm_loadu_si128( reinterpret_cast< const __m128i* >( this->lit + q ) ) ) );
+    if( batchCount - q < 16 ) {
+      mask &= ( 1u << ( batchCount - q ) ) - 1u;
+    }
+    if( !mask ) {
+      continue;
+    }
+    const int bit = first + q;
+    const unsigned long long wide = ( unsigned long long ) mask << ( bit & 31 );
+    this->bits[ bit >> 5 ] |= ( unsigned int ) wide;
+    this->bits[ ( bit >> 5 ) + 1 ] |= ( unsigned int ) ( wide >> 32 );
+  }
+}//_QueryBatch
+
+
+
+/*
+===========
+  _CollectChanges
+      [ wordBegin; wordEnd )   :   
+      
+===========
+*/
+void LBufferVisibilitySet::_CollectChanges( int wordBegin, int wordEnd ) {
+  const __m128i zero = _mm_setzero_si128();
+  for( int word = wordBegin; word < wordEnd; word += 4 ) {
+    const __m128i difference = _mm_xor_si128( _mm_loadu_si128( reinterpret_cast< const __m128i* >( &this->bits[ word ] ) ), _mm_loadu_si128( reinterpret_cast< const __m128i* >( &this->previous[ word ] ) ) );
+    if( _mm_movemask_epi8( _mm_cmpeq_epi32( difference, zero ) ) == 0xFFFF ) {
+      continue;
+    }
+    for( int q = word, qEnd = min( word + 4, wordEnd ); q < qEnd; ++q ) {
+      unsigned int flipped = this->bits[ q ] ^ this->previous[ q ];
+      while( flipped ) {
+        this->changed.push_back( ( q << 5 ) + LBufferLowestBit( flipped ) );
+        flipped &= flipped - 1u;
+      }
+    }
+  }
+}//_CollectChanges
+
+
+
+/*
+===========
+  _CollectChanges
+          :    
+     ,    ,     
+    
+===========
+*/
+void LBufferVisibilitySet::_CollectChanges() {
+  int row = this->active.y0,
+      previousRow = this->previousActive.y0,
+      compared = 0; //  compared  
+  while( row < this->active.y1 || previousRow < this->previousActive.y1 ) {
+    int begin, end;
+    const bool takeActive = ( previousRow >= this->previousActive.y1 || ( row < this->active.y1 && _GetRowWordBegin( this->active, row ) <= _GetRowWordBegin( this->previousActive, previousRow ) ) );
+    if( takeActive ) {
+      begin = _GetRowWordBegin( this->active, row );
+      end = _GetRowWordEnd( this->active, row );
+      ++row;
+    } else {
+      begin = _GetRowWordBegin( this->previousActive, previousRow );
+      end = _GetRowWordEnd( this->previousActive, previousRow );
+      ++previousRow;
+    }
+    begin = max( begin, compared );
+    if( begin < end ) {
+      this->_CollectChanges( begin, end );
+      compared = end;
+    }
+  }
+}//_CollectChanges
+
+
+
+/*
+===========
+  UpdateGrid
+     gridWidth x gridHeight:   ( x, y ) - gridOrigin + ( x + 0.5, y + 0.5 ) * cellSize.
+             
+===========
+*/
+void LBufferVisibilitySet::UpdateGrid( const LBuffer& buffer, const Vec2& viewer, const Vec2& gridOrigin, float cellSize, int gridWidth, int gridHeight ) {
+  this->_BeginUpdate( gridWidth * gridHeight );
+  const float radius = buffer.GetLightRadius(),
+              invCellSize = 1.0f / cellSize;
+  const int x0 = max( int( floorf( ( viewer.x - radius - gridOrigin.x ) * invCellSize - 0.5f ) ), 0 ),
+            x1 = min( int( ceilf( ( viewer.x + radius - gridOrigin.x ) * invCellSize - 0.5f ) ) + 1, gridWidth ),
+            y0 = max( int( floorf( ( viewer.y - radius - gridOrigin.y ) * invCellSize - 0.5f ) ), 0 ),
+            y1 = min( int( ceilf( ( viewer.y + radius - gridOrigin.y ) * invCellSize - 0.5f ) ) + 1, gridHeight );
+  if( x0 < x1 && y0 < y1 ) {
+    const float firstX = gridOrigin.x + 0.5f * cellSize - viewer.x;
+    for( int y = y0; y < y1; ++y ) {
+      const float pointY = gridOrigin.y + ( float( y ) + 0.5f ) * cellSize - viewer.y;
+      for( int x = x0; x < x1; x += LBUFFER_VISIBILITY_BATCH ) {
+        const int batchCount = min( x1 - x, LBUFFER_VISIBILITY_BATCH );
+        for( int q = 0; q < batchCount; ++q ) {
+          this->points[ q ].x = firstX + float( x + q ) * cellSize;
+          this->points[ q ].y = pointY;
+        }
+        this->_QueryBatch( buffer, y * gridWidth + x, batchCount );
+      }
+    }
+    this->active.x0 = x0;
+    this->active.x1 = x1;
+    this->active.y0 = y0;
+    this->active.y1 = y1;
+    this->active.width = gridWidth;
+  }
+  this->_CollectChanges();
+}//UpdateGrid
+
+
+
+/*
+===========
+  UpdatePoints
+   count       
+===========
+*/
+void LBufferVisibilitySet::UpdatePoints( const LBuffer& buffer, const Vec2& viewer, const Vec2 *positions, int count ) {
+  this->_BeginUpdate( count );
+  for( int first = 0; first < count; first += LBUFFER_VISIBILITY_BATCH ) {
+    const int batchCount = min( count - first, LBUFFER_VISIBILITY_BATCH );
+    for( int q = 0; q < batchCount; ++q ) {
+      this->points[ q ].x = positions[ first + q ].x - viewer.x;
+      this->points[ q ].y = positions[ first + q ].y - viewer.y;
+    }
+    this->_QueryBatch( buffer, first, batchCount );
+  }
+  this->active.x0 = 0;
+  this->active.x1 = count;
+  this->active.y0 = 0;
+  this->active.y1 = ( count ? 1 : 0 );
+  this->active.width = count;
+  this->_CollectChanges();
+}//UpdatePoints
@@ -0,0 +1,77 @@
+#ifndef __LBUFFERVISIBILITY_H__
+#define __LBUFFERVISIBILITY_H__
+
+
+#include <vector>
+#include "lbuffer.h"
+
+
+const int LBUFFER_VISIBILITY_BATCH = 256; //    LBuffer::QueryVisibility
+
+
+// [ x0; x1 ) x [ y0; y1 )     width ;   y0 >= y1
+struct LBufferVisibilityRect {
+  int x0, x1;
+  int y0, y1;
+  int width;
+};
+
+
+/*
+        :   ( )
+       (  ).   index -  index & 31  index >> 5.
+   -  L- buffer,    viewer;  ,  LBuffer::QueryVisibility
+     .
+  Update          GetChanged  ,   .
+    ,            
+  (  ),   ,       .
+         :    .
+*/
+class LBufferVisibilitySet
+{
+public:
+  LBufferVisibilitySet();
+  virtual ~LBufferVisibilitySet();
+  void UpdateGrid( const LBuffer& buffer, const Vec2& viewer, const Vec2& gridOrigin, float cellSize, int gridWidth, int gridHeight );
+  void UpdatePoints( const LBuffer& buffer, const Vec2& viewer, const Vec2 *positions, int count );
+  void Reset();
+  inline bool IsVisible( int index ) const {
+    return ( ( this->bits[ index >> 5 ] >> ( index & 31 ) ) & 1 ) != 0;
+  }
+  inline const unsigned int* GetBits() const {
+    return this->bits.data();
+  }
+  inline int GetCount() const {
+    return this->count;
+  }
+  inline const std::vector< int >& GetChanged() const { //  
+    return this->changed;
+  }
+
+private:
+  LBufferVisibilitySet( const LBufferVisibilitySet& );
+  LBufferVisibilitySet& operator=( const LBufferVisibilitySet& );
+  void _Resize( int setCount );
+  void _BeginUpdate( int setCount );
+  void _QueryBatch( const LBuffer& buffer, int first, int batchCount );
+  void _CollectChanges( int wordBegin, int wordEnd );
+  void _CollectChanges();
+  static inline int _GetRowWordBegin( const LBufferVisibilityRect& rect, int y ) {
+    return ( y * rect.width + rect.x0 ) >> 5;
+  }
+  static inline int _GetRowWordEnd( const LBufferVisibilityRect& rect, int y ) {
+    return ( y * rect.width + rect.x1 + 31 ) >> 5;
+  }
+
+  int count;
+  std::vector< unsigned int > bits;     //         
+  std::vector< unsigned int > previous;
+  LBufferVisibilityRect active;         //,      bits
+  LBufferVisibilityRect previousActive; //   previous
+  std::vector< int > changed;
+  Vec2 points[ LBUFFER_VISIBILITY_BATCH ];
+  unsigned char lit[ LBUFFER_VISIBILITY_BATCH ];
+};
+
+
+#endif
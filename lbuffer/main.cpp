@@ -1,6 +1,17 @@
 #include "lib/logs.h"
 #include "lbuffer.h"
+#include "lbufferstorage.h"
+#include "lbufferstatic.h"
+#include "lbufferset.h"
+#include "lbufferthreadpool.h"
+#include "lbufferlayered.h"
+#include "lbuffersoftshadow.h"
+#include "lbufferlightmap.h"
+#include "lbuffervisibility.h"
 #include "lib/klib.h"
+#include <vector>
+#include <thread>
+#include <atomic>
 
 
 LBuffer *buffer = nullptr;
@@ -21,6 +32,61 @@ public:
 };
 
 
+//    
+static unsigned int testSeed = 1;
+float TestRandom( float from, float to ) {
+  testSeed = testSeed * 1664525u + 1013904223u;
+  return from + ( to - from ) * float( testSeed >> 8 ) * ( 1.0f / 16777216.0f );
+}//TestRandom
+
+
+// : count    range,      
+void TestScene( std::vector< Vec2 >& outPoints, int count, float range ) {
+  outPoints.clear();
+  for( int q = 0; q < count; ++q ) {
+    const Vec2 point( TestRandom( -range, range ), TestRandom( -range, range ) );
+    if( q % 8 == 0 ) {
+      outPoints.push_back( point );
+      outPoints.push_back( point * TestRandom( 1.1f, 2.0f ) );
+    } else {
+      outPoints.push_back( point );
+      outPoints.push_back( point + Vec2( TestRandom( -range, range ), TestRandom( -range, range ) ) * 0.05f );
+    }
+  }
+}//TestScene
+
+
+// ,    
+int TestCompare( LBuffer& a, LBuffer& b ) {
+  int different = 0;
+  for( int q = 0; q < a.GetSize(); ++q ) {
+    if( a.GetValueByIndex( q ) != b.GetValueByIndex( q ) ) {
+      ++different;
+    }
+  }
+  return different;
+}//TestCompare
+
+
+//    radius   center
+void TestPolygon( std::vector< Vec2 >& outPoints, const Vec2& center, int count, float radius ) {
+  outPoints.clear();
+  for( int q = 0; q < count; ++q ) {
+    outPoints.push_back( center + Vec2( Math::Cos( q * Math::TWO_PI / count ), Math::Sin( q * Math::TWO_PI / count ) ) * radius );
+  }
+}//TestPolygon
+
+
+//     ,   
+int TestCompareSet( LBufferSet& set, std::vector< LBuffer* >& lights ) {
+  int different = 0;
+  for( int q = 0; q < set.GetLightCount(); ++q ) {
+    different += TestCompare( set.GetBuffer( q ), *lights[ q ] );
+  }
+  return different;
+}//TestCompareSet
+
+
 int main() {
   Math::Init();
   buffer = new LBuffer( 16 );
@@ -71,9 +137,929 @@ int main() {
 
   {//DrawLine test
     float x = 0.7f;
-    LOGD( "Test: pos[%3.3f] iPos[%d] value[%3.16f] result[%s]\n", x, ( int ) buffer->FloatToSize( x ), buffer->GetValue( x ), ( Math::Fabs( buffer->GetValue( x ) - 2.1987860202789307f ) < Math::FLT_EPSILON_NUM ? "ok" : "failed" ) );
+    LOGD( "Test: pos[%3.3f] iPos[%d] value[%3.16f] result[%s]\n", x, ( int ) buffer->FloatToSize( x ), buffer->GetValue( x ), ( Math::Fabs( buffer->GetValue( x ) - 2.1988658f ) < 0.00001f ? "ok" : "failed" ) );
     x = 0.3f;
-    LOGD( "Test: pos[%3.3f] iPos[%d] value[%3.16f] result[%s]\n", x, ( int ) buffer->FloatToSize( x ), buffer->GetValue( x ), ( Math::Fabs( buffer->GetValue( x ) - 2.8490004539489746f ) < Math::FLT_EPSILON_NUM ? "ok" : "failed" ) );
+    LOGD( "Test: pos[%3.3f] iPos[%d] value[%3.16f] result[%s]\n", x, ( int ) buffer->FloatToSize( x ), buffer->GetValue( x ), ( Math::Fabs( buffer->GetValue( x ) - 2.8499868f ) < 0.00001f ? "ok" : "failed" ) );
+  }
+
+
+  {// :  -         
+    LBuffer single( 1024, Math::TWO_PI ), batch( 1024, Math::TWO_PI );
+    const Vec2 radial[ 2 ] = { Vec2( 0.0f, -10.0f ), Vec2( 0.0f, -20.0f ) };
+    single.Clear( 1000.0f );
+    batch.Clear( 1000.0f );
+    single.DrawLine( NULL, radial[ 0 ], radial[ 1 ] );
+    batch.DrawSegments( NULL, radial, 1 );
+    float singleNearest = 1000.0f, batchNearest = 1000.0f;
+    for( int q = 0; q < single.GetSize(); ++q ) {
+      singleNearest = min( singleNearest, single.GetValueByIndex( q ) );
+      batchNearest = min( batchNearest, batch.GetValueByIndex( q ) );
+    }
+    LOGD( "Test: radial DrawLine[%3.6f] DrawSegments[%3.6f] result[%s]\n", singleNearest, batchNearest, ( singleNearest == 10.0f && batchNearest == 10.0f ? "ok" : "failed" ) );
+  }
+
+
+  {// : columnsPerTurn  65536
+    LBuffer partial( 16384 ), circle( 100000, Math::TWO_PI );
+    int column = partial.GetColumnOfAngle( 0xF0000000u );
+    LOGD( "Test: columnsPerTurn[%3.1f] angle[0xF0000000] column[%d] result[%s]\n", partial.GetColumnsPerTurn(), column, ( column >= 96509 && column <= 96511 ? "ok" : "failed" ) );
+    column = circle.GetColumnOfAngle( 0xC0000000u );
+    LOGD( "Test: size[100000] angle[0xC0000000] column[%d] result[%s]\n", column, ( column >= 74999 && column <= 75001 ? "ok" : "failed" ) );
+    circle.Clear( 1000.0f );
+    circle.DrawLine( NULL, Vec2( -1.0f, 10.0f ), Vec2( 1.0f, 10.0f ) );
+    LOGD( "Test: size[100000] DrawLine value[%3.3f] result[%s]\n", circle.GetValueByIndex( 75000 ), ( Math::Fabs( circle.GetValueByIndex( 75000 ) - 10.0f ) < 0.001f && circle.GetValueByIndex( 9463 ) == 1000.0f ? "ok" : "failed" ) );
+  }
+
+
+  {//StaticLBuffer   LBuffer   ;       
+    std::vector< Vec2 > points, polygon;
+    TestScene( points, 600, 300.0f );
+    const int segments = int( points.size() ) / 2, threadCount = 4;
+    TestPolygon( polygon, Vec2( 40.0f, -30.0f ), 7, 12.0f );
+    LBuffer reference252( 252, Math::TWO_PI ), reference256( 256, Math::TWO_PI );
+    reference252.Clear( 400.0f );
+    reference256.Clear( 400.0f );
+    for( int q = 0; q < segments; ++q ) {
+      reference252.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+      reference256.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+    }
+    reference252.DrawPolygon( NULL, &polygon[ 0 ], int( polygon.size() ) );
+    reference256.DrawPolygon( NULL, &polygon[ 0 ], int( polygon.size() ) );
+    std::vector< int > threadDifferent( threadCount, 0 );
+    std::vector< std::thread > threads;
+    for( int t = 0; t < threadCount; ++t ) {
+      threads.push_back( std::thread( [ &, t ]() {
+        StaticLBuffer< 252 > local;
+        local.Clear( 400.0f );
+        for( int q = 0; q < segments; ++q ) {
+          local.DrawLine( points[ q * 2 ], points[ q * 2 + 1 ] );
+        }
+        local.DrawPolygon( &polygon[ 0 ], int( polygon.size() ) );
+        for( int q = 0; q < local.GetSize(); ++q ) {
+          threadDifferent[ t ] += ( local.GetValueByIndex( q ) != reference252.GetValueByIndex( q ) ? 1 : 0 );
+        }
+      } ) );
+    }
+    for( auto &thread: threads ) {
+      thread.join();
+    }
+    StaticLBuffer< 256 > power;
+    power.Clear( 400.0f );
+    for( int q = 0; q < segments; ++q ) {
+      power.DrawLine( points[ q * 2 ], points[ q * 2 + 1 ] );
+    }
+    power.DrawPolygon( &polygon[ 0 ], int( polygon.size() ) );
+    int different = 0;
+    for( int q = 0; q < power.GetSize(); ++q ) {
+      different += ( power.GetValueByIndex( q ) != reference256.GetValueByIndex( q ) ? 1 : 0 );
+    }
+    for( auto &count: threadDifferent ) {
+      different += count;
+    }
+    LOGD( "Test: StaticLBuffer threads[%d] different[%d] result[%s]\n", threadCount, different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//WriteFromCache:       ,      
+    std::vector< Vec2 > points;
+    TestScene( points, 400, 500.0f );
+    const int segments = int( points.size() ) / 2;
+    LBuffer direct( 4096, Math::TWO_PI ), cached( 4096, Math::TWO_PI );
+    std::vector< Object > objects( segments );
+    for( int pass = 0; pass < 2; ++pass ) {
+      direct.Clear( 600.0f );
+      cached.Clear( 600.0f );
+      for( int q = 0; q < segments; ++q ) {
+        objects[ q ].position = points[ q * 2 ];
+        direct.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+        LBufferCacheEntity *entity = NULL;
+        if( cached.IsObjectCached( &objects[ q ], &entity ) ) {
+          cached.WriteFromCache( entity );
+        } else {
+          entity->Reset( objects[ q ].GetPosition(), objects[ q ].GetSize() );
+          cached.DrawLine( entity, points[ q * 2 ], points[ q * 2 + 1 ] );
+        }
+      }
+    }
+    const Vec2 tail[ 2 ] = { Vec2( -550.0f, -30.0f ), Vec2( 550.0f, -40.0f ) };
+    direct.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    cached.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    const int different = TestCompare( direct, cached );
+    LOGD( "Test: WriteFromCache different[%d] result[%s]\n", different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//LBufferSet: DrawLine, DrawSegments, DrawPolygon  DrawPolygonOccluder      
+    const int lightCount = 40, size = 512;
+    LBufferSet set( lightCount, size );
+    std::vector< LBuffer* > lights;
+    for( int q = 0; q < lightCount; ++q ) {
+      set.SetLight( q, Vec2( TestRandom( -500.0f, 500.0f ), TestRandom( -500.0f, 500.0f ) ), TestRandom( 50.0f, 250.0f ) );
+      lights.push_back( new LBuffer( size, Math::TWO_PI ) );
+      lights[ q ]->Clear( set.GetLightRadius( q ) );
+    }
+    std::vector< Vec2 > points, polygon, local;
+    TestScene( points, 1500, 500.0f );
+    const int segments = int( points.size() ) / 2;
+    const Vec2 line[ 2 ] = { Vec2( -480.0f, -470.0f ), Vec2( 490.0f, 460.0f ) };
+    set.Clear();
+    set.DrawSegments( &points[ 0 ], segments );
+    set.DrawLine( line[ 0 ], line[ 1 ] );
+    for( int q = 0; q < lightCount; ++q ) {
+      const Vec2 position = set.GetLightPosition( q );
+      for( int w = 0; w < segments; ++w ) {
+        lights[ q ]->DrawLine( NULL, points[ w * 2 ] - position, points[ w * 2 + 1 ] - position );
+      }
+      lights[ q ]->DrawLine( NULL, line[ 0 ] - position, line[ 1 ] - position );
+    }
+    for( int w = 0; w < 100; ++w ) {
+      TestPolygon( polygon, Vec2( TestRandom( -500.0f, 500.0f ), TestRandom( -500.0f, 500.0f ) ), 3 + w % 7, TestRandom( 2.0f, 10.0f ) );
+      if( w & 1 ) {
+        set.DrawPolygonOccluder( &polygon[ 0 ], int( polygon.size() ) );
+      } else {
+        set.DrawPolygon( &polygon[ 0 ], int( polygon.size() ) );
+      }
+      for( int q = 0; q < lightCount; ++q ) {
+        local.clear();
+        for( auto &point: polygon ) {
+          local.push_back( point - set.GetLightPosition( q ) );
+        }
+        if( w & 1 ) {
+          lights[ q ]->DrawPolygonOccluder( NULL, &local[ 0 ], int( local.size() ) );
+        } else {
+          lights[ q ]->DrawPolygon( NULL, &local[ 0 ], int( local.size() ) );
+        }
+      }
+    }
+    const int different = TestCompareSet( set, lights );
+    LOGD( "Test: LBufferSet lights[%d] different[%d] result[%s]\n", lightCount, different, ( !different ? "ok" : "failed" ) );
+    for( auto &light: lights ) {
+      delete light;
+    }
+  }
+
+
+  {//LBufferThreadPool::Run:      
+    LBufferThreadPool pool( 4 );
+    const int jobCount = 37;
+    std::vector< std::atomic< int > > visits( jobCount );
+    int wrong = 0;
+    for( int run = 0; run < 200; ++run ) {
+      for( auto &visit: visits ) {
+        visit = 0;
+      }
+      std::atomic< int > sum( 0 );
+      pool.Run( jobCount, [ & ]( int job ) {
+        ++visits[ job ];
+        sum += job;
+      } );
+      for( auto &visit: visits ) {
+        wrong += ( visit != 1 ? 1 : 0 );
+      }
+      wrong += ( sum != jobCount * ( jobCount - 1 ) / 2 ? 1 : 0 );
+    }
+    pool.Run( 0, [ & ]( int ) {
+      ++wrong;
+    } );
+    LOGD( "Test: LBufferThreadPool threads[%d] wrong[%d] result[%s]\n", pool.GetThreadCount(), wrong, ( pool.GetThreadCount() == 4 && !wrong ? "ok" : "failed" ) );
+  }
+
+
+  {//LBufferSet::Render   (    )      
+    const int lightCount = 32, size = 1024;
+    LBufferSet set( lightCount, size );
+    LBufferThreadPool pool( 4 );
+    LBufferOccluderSet occluders;
+    std::vector< LBuffer* > lights;
+    for( int q = 0; q < lightCount; ++q ) {
+      set.SetLight( q, Vec2( TestRandom( -500.0f, 500.0f ), TestRandom( -500.0f, 500.0f ) ), ( q % 8 ? TestRandom( 50.0f, 200.0f ) : TestRandom( 600.0f, 900.0f ) ) );
+      lights.push_back( new LBuffer( size, Math::TWO_PI ) );
+      lights[ q ]->Clear( set.GetLightRadius( q ) );
+    }
+    std::vector< Vec2 > points, polygon, local;
+    TestScene( points, 2000, 500.0f );
+    const int segments = int( points.size() ) / 2;
+    for( int w = 0; w < segments; ++w ) {
+      occluders.AddSegment( points[ w * 2 ], points[ w * 2 + 1 ] );
+      for( int q = 0; q < lightCount; ++q ) {
+        lights[ q ]->DrawLine( NULL, points[ w * 2 ] - set.GetLightPosition( q ), points[ w * 2 + 1 ] - set.GetLightPosition( q ) );
+      }
+    }
+    for( int w = 0; w < 200; ++w ) {
+      TestPolygon( polygon, Vec2( TestRandom( -500.0f, 500.0f ), TestRandom( -500.0f, 500.0f ) ), 3 + w % 13, TestRandom( 2.0f, 10.0f ) );
+      if( w & 1 ) {
+        occluders.AddPolygon( &polygon[ 0 ], int( polygon.size() ) );
+      } else {
+        occluders.AddPolyline( &polygon[ 0 ], int( polygon.size() ) );
+      }
+      for( int q = 0; q < lightCount; ++q ) {
+        local.clear();
+        for( auto &point: polygon ) {
+          local.push_back( point - set.GetLightPosition( q ) );
+        }
+        if( w & 1 ) {
+          lights[ q ]->DrawPolygonOccluder( NULL, &local[ 0 ], int( local.size() ) );
+        } else {
+          lights[ q ]->DrawPolyline( NULL, &local[ 0 ], int( local.size() ) );
+        }
+      }
+    }
+    set.Render( occluders, &pool );
+    int split = 0;
+    for( int q = 0; q < lightCount; ++q ) {
+      split += ( set.GetLightParts( q ) > 1 ? 1 : 0 );
+    }
+    const int different = TestCompareSet( set, lights );
+    // Render           
+    const Vec2 line[ 2 ] = { Vec2( -900.0f, -890.0f ), Vec2( 880.0f, 900.0f ) };
+    set.DrawLine( line[ 0 ], line[ 1 ] );
+    for( int q = 0; q < lightCount; ++q ) {
+      lights[ q ]->DrawLine( NULL, line[ 0 ] - set.GetLightPosition( q ), line[ 1 ] - set.GetLightPosition( q ) );
+    }
+    const int afterDifferent = TestCompareSet( set, lights );
+    LOGD( "Test: LBufferSet::Render split[%d] different[%d] after DrawLine[%d] result[%s]\n", split, different, afterDifferent, ( split && !different && !afterDifferent ? "ok" : "failed" ) );
+    for( auto &light: lights ) {
+      delete light;
+    }
+  }
+
+
+  {//DrawSegments  DrawSegmentsParallel   DrawLine
+    std::vector< Vec2 > points;
+    TestScene( points, 3000, 900.0f );
+    const int segments = int( points.size() ) / 2;
+    LBufferThreadPool pool( 4 );
+    LBuffer lines( 16384, Math::TWO_PI ), batch( 16384, Math::TWO_PI ), parallel( 16384, Math::TWO_PI );
+    lines.Clear( 1000.0f );
+    batch.Clear( 1000.0f );
+    parallel.Clear( 1000.0f );
+    for( int q = 0; q < segments; ++q ) {
+      lines.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+    }
+    batch.DrawSegments( NULL, &points[ 0 ], segments );
+    parallel.DrawSegmentsParallel( &points[ 0 ], segments, &pool );
+    const int batchDifferent = TestCompare( lines, batch ),
+              parallelDifferent = TestCompare( lines, parallel );
+    LOGD( "Test: segments[%d] DrawSegments[%d] DrawSegmentsParallel[%d] result[%s]\n", segments, batchDifferent, parallelDifferent, ( !batchDifferent && !parallelDifferent ? "ok" : "failed" ) );
+  }
+
+
+  {//BeginConcurrent/EndConcurrent:            
+    std::vector< Vec2 > points;
+    TestScene( points, 4000, 900.0f );
+    const int segments = int( points.size() ) / 2, threadCount = 4;
+    LBuffer serial( 16384, Math::TWO_PI ), shared( 16384, Math::TWO_PI );
+    serial.Clear( 1000.0f );
+    shared.Clear( 1000.0f );
+    for( int q = 0; q < segments; ++q ) {
+      serial.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+    }
+    const bool begun = shared.BeginConcurrent();
+    std::vector< std::thread > threads;
+    for( int t = 0; t < threadCount; ++t ) {
+      threads.push_back( std::thread( [ &, t ]() {
+        const int from = segments * t / threadCount, to = segments * ( t + 1 ) / threadCount;
+        if( t & 1 ) {
+          shared.DrawSegments( NULL, &points[ from * 2 ], to - from );
+        } else {
+          for( int q = from; q < to; ++q ) {
+            shared.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+          }
+        }
+      } ) );
+    }
+    for( auto &thread: threads ) {
+      thread.join();
+    }
+    shared.EndConcurrent();
+    const Vec2 tail[ 2 ] = { Vec2( -950.0f, 20.0f ), Vec2( 950.0f, 30.0f ) };
+    serial.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    shared.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    const int different = TestCompare( serial, shared );
+    LOGD( "Test: concurrent threads[%d] different[%d] result[%s]\n", threadCount, different, ( begun && !different && !shared.IsConcurrent() ? "ok" : "failed" ) );
+  }
+
+
+  {//BeginFrame/Submit/Flush   DrawLine,    Flush    
+    std::vector< Vec2 > points;
+    TestScene( points, 3000, 900.0f );
+    const int segments = int( points.size() ) / 2;
+    LBuffer lines( 16384, Math::TWO_PI ), binned( 16384, Math::TWO_PI );
+    lines.Clear( 1000.0f );
+    binned.Clear( 1000.0f );
+    binned.BeginFrame();
+    for( int q = 0; q < segments; ++q ) {
+      lines.DrawLine( NULL, points[ q * 2 ], points[ q * 2 + 1 ] );
+      binned.Submit( points[ q * 2 ], points[ q * 2 + 1 ] );
+    }
+    binned.Flush();
+    const Vec2 tail[ 2 ] = { Vec2( -950.0f, 20.0f ), Vec2( 950.0f, 30.0f ) };
+    lines.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    binned.DrawLine( NULL, tail[ 0 ], tail[ 1 ] );
+    const int different = TestCompare( lines, binned );
+    LOGD( "Test: segments[%d] Flush different[%d] result[%s]\n", segments, different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//BeginObject/RemoveObject/UpdateObjects: ,       Clear   
+    const int count = 120, size = 4096;
+    LBuffer incremental( size, Math::TWO_PI ), full( size, Math::TWO_PI );
+    std::vector< Object > objects( count );
+    std::vector< std::vector< Vec2 > > shapes( count );
+    std::vector< bool > alive( count );
+    incremental.Clear( 1000.0f );
+    for( int q = 0; q < count; ++q ) {
+      objects[ q ].position.Set( TestRandom( -900.0f, 900.0f ), TestRandom( -900.0f, 900.0f ) );
+      objects[ q ].size.Set( TestRandom( 3.0f, 30.0f ), 0.0f );
+      alive[ q ] = ( q < count - 20 );
+    }
+    int different = 0;
+    for( int frame = 0; frame < 12; ++frame ) {
+      for( int q = 0; q < count; ++q ) {
+        const bool moved = ( frame == 0 || q % 12 == frame );
+        if( !moved ) {
+          continue;
+        }
+        if( frame ) {
+          objects[ q ].position += Vec2( TestRandom( -20.0f, 20.0f ), TestRandom( -20.0f, 20.0f ) );
+          if( q % 3 == 0 ) {
+            alive[ q ] = !alive[ q ];
+          }
+        }
+        TestPolygon( shapes[ q ], objects[ q ].position, 3 + q % 6, objects[ q ].size.x );
+        if( alive[ q ] ) {
+          LBufferCacheEntity *entity = incremental.BeginObject( &objects[ q ] );
+          incremental.DrawPolygon( entity, &shapes[ q ][ 0 ], int( shapes[ q ].size() ) );
+          incremental.EndObject();
+        } else if( frame ) {
+          incremental.RemoveObject( &objects[ q ] );
+        }
+      }
+      incremental.UpdateObjects();
+      full.Clear( 1000.0f );
+      for( int q = 0; q < count; ++q ) {
+        if( alive[ q ] ) {
+          full.DrawPolygon( NULL, &shapes[ q ][ 0 ], int( shapes[ q ].size() ) );
+        }
+      }
+      different += TestCompare( incremental, full );
+    }
+    const Vec2 line[ 2 ] = { Vec2( -900.0f, 5.0f ), Vec2( 900.0f, 50.0f ) };
+    incremental.DrawLine( NULL, line[ 0 ], line[ 1 ] );
+    full.DrawLine( NULL, line[ 0 ], line[ 1 ] );
+    different += TestCompare( incremental, full );
+    LOGD( "Test: UpdateObjects objects[%d] different[%d] result[%s]\n", incremental.GetObjectCount(), different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//LayeredLBuffer:   -     ,    StaticLBuffer   
+    const int objectCount = 40, layerCount = 3;
+    const float radius = 300.0f;
+    LayeredLBuffer< layerCount > layered( 500 );
+    std::vector< StaticLBuffer< 500 > > singles( objectCount );
+    std::vector< Vec2 > polygon;
+    layered.Clear( radius );
+    for( int q = 0; q < objectCount; ++q ) {
+      const Vec2 center( TestRandom( -150.0f, 150.0f ), TestRandom( -150.0f, 150.0f ) );
+      singles[ q ].Clear( radius );
+      if( q % 3 ) {
+        TestPolygon( polygon, center, 3 + q % 9, TestRandom( 2.0f, 25.0f ) );
+        layered.DrawPolygon( &polygon[ 0 ], int( polygon.size() ), q );
+        singles[ q ].DrawPolygon( &polygon[ 0 ], int( polygon.size() ) );
+      } else {
+        const Vec2 end( center + Vec2( TestRandom( -60.0f, 60.0f ), TestRandom( -60.0f, 60.0f ) ) );
+        layered.DrawLine( center, end, q );
+        singles[ q ].DrawLine( center, end );
+      }
+    }
+    int different = 0, filled = 0;
+    LBufferLayer layers[ layerCount ];
+    for( int x = 0; x < layered.GetSize(); ++x ) {
+      // layerCount     ,    -  
+      LBufferLayer expected[ layerCount ];
+      int expectedCount = 0;
+      for( int q = 0; q < objectCount; ++q ) {
+        const float value = singles[ q ].GetValueByIndex( x );
+        if( value >= radius ) {
+          continue;
+        }
+        int w = ( expectedCount < layerCount ? expectedCount++ : layerCount );
+        for( ; w > 0 && expected[ w - 1 ].depth > value; --w ) {
+          if( w < layerCount ) {
+            expected[ w ] = expected[ w - 1 ];
+          }
+        }
+        if( w < layerCount ) {
+          expected[ w ].depth = value;
+          expected[ w ].tag = q;
+        }
+      }
+      const int count = layered.GetLayers( x, layers );
+      filled += count;
+      if( count != expectedCount ) {
+        ++different;
+        continue;
+      }
+      for( int w = 0; w < count; ++w ) {
+        const bool tie = ( w + 1 < count && expected[ w + 1 ].depth == expected[ w ].depth ) || ( w > 0 && expected[ w - 1 ].depth == expected[ w ].depth );
+        if( layers[ w ].depth != expected[ w ].depth || ( layers[ w ].tag != expected[ w ].tag && !tie ) ) {
+          ++different;
+          break;
+        }
+      }
+    }
+    LOGD( "Test: LayeredLBuffer layers[%d] filled[%d] different[%d] result[%s]\n", layerCount, filled, different, ( filled && !different ? "ok" : "failed" ) );
+  }
+
+
+  {//LBufferSoftShadow:           ,       0
+    const float radius = 800.0f;
+    int different = 0, wrapped = 0;
+    for( int full = 0; full < 2; ++full ) {
+      const int size = ( full ? 1021 : 1024 );
+      LBuffer source( size, ( full ? Math::TWO_PI : 2.0f ) );
+      source.Clear( radius );
+      std::vector< Vec2 > points;
+      TestScene( points, 300, 700.0f );
+      source.DrawSegments( NULL, &points[ 0 ], int( points.size() ) / 2 );
+      LBufferSoftShadow shadow;
+      shadow.SetMinVariance( 0.0f );
+      shadow.Build( source );
+      std::vector< double > codes( size );
+      for( int x = 0; x < size; ++x ) {
+        codes[ x ] = double( int( min( source.GetValueByIndex( x ) * ( LBUFFER_SOFT_SHADOW_LEVELS / radius ) + 0.5f, LBUFFER_SOFT_SHADOW_LEVELS ) ) );
+      }
+      for( int t = 0; t < 400; ++t ) {
+        //    0   
+        const float column = ( t < 2 ? ( t ? float( size ) - 0.7f : 0.3f ) : TestRandom( 0.0f, float( size ) - 0.01f ) ),
+                    kernel = ( t < 2 ? 40.0f : ( t % 5 ? TestRandom( 0.0f, 120.0f ) : TestRandom( 0.0f, 3.0f ) ) ),
+                    distance = TestRandom( 0.0f, radius );
+        const int width = max( int( kernel + 0.5f ), 1 ),
+                  begin = int( Math::Floor( column - 0.5f * float( width ) + 0.5f ) );
+        double sum = 0.0, sumSquares = 0.0;
+        int count = 0;
+        for( int k = 0; k < width; ++k ) {
+          int x = begin + k;
+          if( x < 0 || x >= size ) {
+            if( !full ) {
+              continue;
+            }
+            x = ( x + size ) % size;
+            wrapped += ( t < 2 ? 1 : 0 );
+          }
+          sum += codes[ x ];
+          sumSquares += codes[ x ] * codes[ x ];
+          ++count;
+        }
+        if( !count ) {
+          sum = codes[ begin < 0 ? 0 : size - 1 ];
+          sumSquares = sum * sum;
+          count = 1;
+        }
+        const double mean = sum / count, variance = sumSquares / count - mean * mean, delta = distance * ( LBUFFER_SOFT_SHADOW_LEVELS / radius ) - mean;
+        const float visibility = ( delta <= 0.0 ? 1.0f : float( variance / ( variance + delta * delta ) ) );
+        if( Math::Fabs( shadow.GetVisibilityByColumn( column, distance, kernel ) - visibility ) > 1.0e-4f || Math::Fabs( shadow.GetMeanDepth( column, kernel ) - float( mean * radius / LBUFFER_SOFT_SHADOW_LEVELS ) ) > 1.0e-3f ) {
+          ++different;
+        }
+      }
+    }
+    LOGD( "Test: LBufferSoftShadow wrapped[%d] different[%d] result[%s]\n", wrapped, different, ( wrapped && !different ? "ok" : "failed" ) );
+  }
+
+
+  {//QueryVisibility/QueryAttenuation   GetColumnOfPoint  GetValueByIndex,     
+    int different = 0;
+    for( int mode = 0; mode < 4; ++mode ) {
+      const int size = ( mode == 1 ? 3001 : 2048 ), count = 1003;
+      const bool full = ( mode != 2 );
+      LBuffer source( size, ( full ? Math::TWO_PI : 3.0f ), ( mode == 3 ? LBUFFER_STORAGE_HALF : LBUFFER_STORAGE_FLOAT ) );
+      source.Clear( 800.0f );
+      std::vector< Vec2 > points;
+      TestScene( points, 300, 700.0f );
+      source.DrawSegments( NULL, &points[ 0 ], int( points.size() ) / 2 );
+      points.resize( count );
+      for( auto &point: points ) {
+        point.Set( TestRandom( -900.0f, 900.0f ), TestRandom( -900.0f, 900.0f ) );
+      }
+      //      0    
+      points[ 0 ].Set( 10.0f, 1.0e-9f );
+      points[ 1 ].Set( 10.0f, -1.0e-9f );
+      points[ 2 ].Set( 0.0f, 0.0f );
+      std::vector< unsigned char > lit( count ), litInterpolated( count );
+      std::vector< float > light( count ), lightInterpolated( count );
+      source.QueryVisibility( &points[ 0 ], count, &lit[ 0 ] );
+      source.QueryVisibility( &points[ 0 ], count, &litInterpolated[ 0 ], true );
+      source.QueryAttenuation( &points[ 0 ], count, &light[ 0 ] );
+      source.QueryAttenuation( &points[ 0 ], count, &lightInterpolated[ 0 ], true );
+      for( int q = 0; q < count; ++q ) {
+        //      
+        const float column = source.GetColumnOfPoint( points[ q ] ),
+                    distanceSquared = points[ q ].x * points[ q ].x + points[ q ].y * points[ q ].y;
+        int index0 = int( column );
+        bool inside = true;
+        if( index0 > size - 1 ) {
+          inside = full;
+          index0 = ( full ? size - 1 : 0 );
+        }
+        const int index1 = ( index0 + 1 < size ? index0 + 1 : ( full ? 0 : size - 1 ) );
+        const float depth0 = ( inside ? source.GetValueByIndex( index0 ) : 0.0f ),
+                    depth1 = ( inside ? source.GetValueByIndex( index1 ) : 0.0f ),
+                    weight = column - float( index0 ),
+                    depth = depth0 + ( depth1 - depth0 ) * weight,
+                    light0 = ( distanceSquared <= depth0 * depth0 ? 1.0f : 0.0f ),
+                    light1 = ( distanceSquared <= depth1 * depth1 ? 1.0f : 0.0f );
+        if( lit[ q ] != ( distanceSquared <= depth0 * depth0 ? 1 : 0 ) || litInterpolated[ q ] != ( distanceSquared <= depth * depth ? 1 : 0 ) ||
+            light[ q ] != light0 || Math::Fabs( lightInterpolated[ q ] - ( light0 + ( light1 - light0 ) * weight ) ) > 1.0e-6f ) {
+          ++different;
+        }
+      }
+    }
+    LOGD( "Test: QueryVisibility QueryAttenuation different[%d] result[%s]\n", different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//LBufferLightmap:    ambient         QueryAttenuation
+    const int lightCount = 8, width = 100, height = 70;
+    const float texelSize = 4.0f, falloff = 1.0e-4f;
+    const Vec2 origin( -200.0f, -140.0f );
+    const Vec4 ambient( 0.05f, 0.05f, 0.1f, 0.0f );
+    std::vector< Vec2 > points;
+    TestScene( points, 200, 200.0f );
+    std::vector< LBuffer* > lights;
+    std::vector< Vec2 > positions;
+    std::vector< float > radii;
+    std::vector< Vec4 > colors;
+    std::vector< Vec2 > local( points.size() );
+    for( int q = 0; q < lightCount; ++q ) {
+      positions.push_back( Vec2( TestRandom( -200.0f, 200.0f ), TestRandom( -140.0f, 140.0f ) ) );
+      radii.push_back( TestRandom( 50.0f, 200.0f ) );
+      colors.push_back( Vec4( TestRandom( 0.0f, 1.0f ), TestRandom( 0.0f, 1.0f ), TestRandom( 0.0f, 1.0f ), 1.0f ) );
+      lights.push_back( new LBuffer( 1024, Math::TWO_PI ) );
+      lights[ q ]->Clear( radii[ q ] );
+      for( int w = 0; w < int( points.size() ); ++w ) {
+        local[ w ] = points[ w ] - positions[ q ];
+      }
+      lights[ q ]->DrawSegments( NULL, &local[ 0 ], int( local.size() ) / 2 );
+    }
+    LBufferThreadPool pool( 4 );
+    int different = 0;
+    for( int format = 0; format < 2; ++format ) {
+      LBufferLightmap lightmap( width, height, ( format ? LBUFFER_LIGHTMAP_RGBA8 : LBUFFER_LIGHTMAP_RGBA_FLOAT ) );
+      lightmap.SetView( origin, texelSize );
+      lightmap.SetAmbient( ambient );
+      for( int q = 0; q < lightCount; ++q ) {
+        lightmap.AddLight( lights[ q ], positions[ q ], radii[ q ], colors[ q ], falloff );
+      }
+      lightmap.Render( format ? &pool : NULL );
+      for( int y = 0; y < height; ++y ) {
+        for( int x = 0; x < width; ++x ) {
+          const Vec2 center( origin + Vec2( ( float( x ) + 0.5f ) * texelSize, ( float( y ) + 0.5f ) * texelSize ) );
+          float expected[ 4 ] = { ambient.x, ambient.y, ambient.z, ambient.w };
+          for( int q = 0; q < lightCount; ++q ) {
+            const Vec2 point( center - positions[ q ] );
+            const float distanceSquared = point.x * point.x + point.y * point.y;
+            if( distanceSquared >= radii[ q ] * radii[ q ] ) {
+              continue;
+            }
+            float visible;
+            lights[ q ]->QueryAttenuation( &point, 1, &visible, true );
+            const float attenuation = ( 1.0f - distanceSquared / ( radii[ q ] * radii[ q ] ) ) * visible / ( 1.0f + falloff * distanceSquared );
+            for( int k = 0; k < 4; ++k ) {
+              expected[ k ] += attenuation * colors[ q ][ k ];
+            }
+          }
+          for( int k = 0; k < 4; ++k ) {
+            const float texel = ( format ? float( lightmap.GetByteData()[ ( y * width + x ) * 4 + k ] ) / 255.0f : lightmap.GetFloatData()[ ( y * width + x ) * 4 + k ] ),
+                        value = ( format ? Math::Floor( min( max( expected[ k ], 0.0f ), 1.0f ) * 255.0f + 0.5f ) / 255.0f : expected[ k ] );
+            if( Math::Fabs( texel - value ) > ( format ? 1.01f / 255.0f : 1.0e-4f ) ) {
+              ++different;
+            }
+          }
+        }
+      }
+    }
+    LOGD( "Test: LBufferLightmap size[%dx%d] different[%d] result[%s]\n", width, height, different, ( !different ? "ok" : "failed" ) );
+    for( auto &light: lights ) {
+      delete light;
+    }
+  }
+
+
+  {//LBufferVisibilitySet:         QueryVisibility     
+    const int gridWidth = 150, gridHeight = 110, entityCount = 333;
+    const float cellSize = 4.0f;
+    const Vec2 gridOrigin( -100.0f, -50.0f );
+    std::vector< Vec2 > walls, entities( entityCount ), local;
+    TestScene( walls, 600, 300.0f );
+    for( auto &wall: walls ) {
+      wall += Vec2( 200.0f, 170.0f );
+    }
+    for( auto &entity: entities ) {
+      entity.Set( TestRandom( -100.0f, 500.0f ), TestRandom( -50.0f, 390.0f ) );
+    }
+    LBuffer source( 1024, Math::TWO_PI );
+    LBufferVisibilitySet grid, points;
+    std::vector< unsigned char > gridPrevious( gridWidth * gridHeight, 0 ), entityPrevious( entityCount, 0 );
+    std::vector< int > changed;
+    Vec2 viewer( 150.0f, 120.0f );
+    int different = 0, changes = 0;
+    for( int frame = 0; frame < 10; ++frame ) {
+      // 6 -  :       
+      viewer = ( frame == 6 ? Vec2( 420.0f, 330.0f ) : viewer + Vec2( TestRandom( -8.0f, 12.0f ), TestRandom( -8.0f, 12.0f ) ) );
+      source.Clear( frame % 2 ? 100.0f : 120.0f );
+      local.resize( walls.size() );
+      for( int q = 0; q < int( walls.size() ); ++q ) {
+        local[ q ] = walls[ q ] - viewer;
+      }
+      source.DrawSegments( NULL, &local[ 0 ], int( local.size() ) / 2 );
+      grid.UpdateGrid( source, viewer, gridOrigin, cellSize, gridWidth, gridHeight );
+      points.UpdatePoints( source, viewer, &entities[ 0 ], entityCount );
+      changed.clear();
+      for( int q = 0; q < gridWidth * gridHeight; ++q ) {
+        const Vec2 point( gridOrigin + Vec2( ( float( q % gridWidth ) + 0.5f ) * cellSize, ( float( q / gridWidth ) + 0.5f ) * cellSize ) - viewer );
+        unsigned char lit;
+        source.QueryVisibility( &point, 1, &lit );
+        if( lit != gridPrevious[ q ] ) {
+          changed.push_back( q );
+          gridPrevious[ q ] = lit;
+        }
+        different += ( grid.IsVisible( q ) != ( lit != 0 ) ? 1 : 0 );
+      }
+      different += ( changed != grid.GetChanged() ? 1 : 0 );
+      changes += int( changed.size() );
+      changed.clear();
+      for( int q = 0; q < entityCount; ++q ) {
+        const Vec2 point( entities[ q ] - viewer );
+        unsigned char lit;
+        source.QueryVisibility( &point, 1, &lit );
+        if( lit != entityPrevious[ q ] ) {
+          changed.push_back( q );
+          entityPrevious[ q ] = lit;
+        }
+        different += ( points.IsVisible( q ) != ( lit != 0 ) ? 1 : 0 );
+      }
+      different += ( changed != points.GetChanged() ? 1 : 0 );
+      changes += int( changed.size() );
+    }
+    LOGD( "Test: LBufferVisibilitySet changes[%d] different[%d] result[%s]\n", changes, different, ( changes && !different ? "ok" : "failed" ) );
+  }
+
+
+  {//StaticLBuffer   LBuffer    ,   
+    std::vector< Vec2 > points, polygon;
+    for( int q = 0; q < 300; ++q ) {
+      points.push_back( Vec2( TestRandom( -150.0f, 150.0f ), TestRandom( -150.0f, 150.0f ) ) );
+    }
+    TestPolygon( polygon, Vec2( 50.0f, 10.0f ), 9, 30.0f );
+    LBuffer reference( 256, Math::TWO_PI );
+    StaticLBuffer< 256 > clipped;
+    reference.Clear( 60.0f );
+    clipped.Clear( 60.0f );
+    for( int q = 0; q + 1 < int( points.size() ); q += 2 ) {
+      reference.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+      clipped.DrawLine( points[ q ], points[ q + 1 ] );
+    }
+    reference.DrawPolygon( NULL, &polygon[ 0 ], int( polygon.size() ) );
+    clipped.DrawPolygon( &polygon[ 0 ], int( polygon.size() ) );
+    int different = 0, written = 0;
+    for( int q = 0; q < clipped.GetSize(); ++q ) {
+      different += ( clipped.GetValueByIndex( q ) != reference.GetValueByIndex( q ) ? 1 : 0 );
+      written += ( reference.GetValueByIndex( q ) < 60.0f ? 1 : 0 );
+    }
+    LOGD( "Test: StaticLBuffer radius clip written[%d] different[%d] result[%s]\n", written, different, ( written && !different ? "ok" : "failed" ) );
+  }
+
+
+  {//  LayeredLBuffer   LBuffer  ,   
+    LayeredLBuffer< 2 > layered( 256 );
+    LBuffer reference( 256, Math::TWO_PI );
+    layered.Clear( 60.0f );
+    reference.Clear( 60.0f );
+    for( int q = 0; q < 150; ++q ) {
+      const Vec2 point0( TestRandom( -150.0f, 150.0f ), TestRandom( -150.0f, 150.0f ) ),
+                 point1( TestRandom( -150.0f, 150.0f ), TestRandom( -150.0f, 150.0f ) );
+      layered.DrawLine( point0, point1, q );
+      reference.DrawLine( NULL, point0, point1 );
+    }
+    int different = 0, written = 0;
+    LBufferLayer layers[ 2 ];
+    for( int x = 0; x < layered.GetSize(); ++x ) {
+      const float value = reference.GetValueByIndex( x );
+      const int count = layered.GetLayers( x, layers );
+      written += ( count ? 1 : 0 );
+      different += ( ( count ? layers[ 0 ].depth : 60.0f ) != value ? 1 : 0 );
+    }
+    LOGD( "Test: LayeredLBuffer radius clip written[%d] different[%d] result[%s]\n", written, different, ( written && !different ? "ok" : "failed" ) );
+  }
+
+
+  {// LINEAR16  LOG8:   ,    ,   LBufferStorage
+    const float range = 500.0f;
+    const LBufferLinear16Encoder linear( range );
+    const LBufferLog8Encoder log8( range );
+    int codeErrors = 0, boundErrors = 0;
+    for( int code = 0; code < 65536; ++code ) {
+      codeErrors += ( linear.Encode( linear.Decode( LBufferLinear16Encoder::Code( code ) ) ) != code ? 1 : 0 );
+    }
+    for( int code = 0; code < 256; ++code ) {
+      codeErrors += ( log8.Encode( log8.Decode( LBufferLog8Encoder::Code( code ) ) ) != code ? 1 : 0 );
+    }
+    float linearWorst = 0.0f, log8Worst = 0.0f;
+    for( int q = 0; q <= 100000; ++q ) {
+      const float depth = range * float( q ) / 100000.0f;
+      const float linearError = Math::Fabs( linear.Decode( linear.Encode( depth ) ) - depth ) / ( range / 128000.0f ),
+                  log8Error = Math::Fabs( log8.Decode( log8.Encode( depth ) ) - depth ) / ( 0.014f * ( depth + range / 1023.0f ) );
+      linearWorst = max( linearWorst, linearError );
+      log8Worst = max( log8Worst, log8Error );
+    }
+    //    :   LBuffer    LBUFFER_STORAGE_FLOAT
+    std::vector< Vec2 > points;
+    TestScene( points, 400, 400.0f );
+    LBuffer exact( 1000, Math::TWO_PI ), linearBuffer( 1000, Math::TWO_PI, LBUFFER_STORAGE_UINT16 ), log8Buffer( 1000, Math::TWO_PI, LBUFFER_STORAGE_UINT8_LOG );
+    exact.Clear( range );
+    linearBuffer.Clear( range );
+    log8Buffer.Clear( range );
+    for( int q = 0; q + 1 < int( points.size() ); q += 2 ) {
+      exact.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+      linearBuffer.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+      log8Buffer.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+    }
+    for( int q = 0; q < exact.GetSize(); ++q ) {
+      const float depth = exact.GetValueByIndex( q );
+      boundErrors += ( Math::Fabs( linearBuffer.GetValueByIndex( q ) - depth ) > range / 128000.0f ? 1 : 0 );
+      boundErrors += ( Math::Fabs( log8Buffer.GetValueByIndex( q ) - depth ) > 0.014f * ( depth + range / 1023.0f ) ? 1 : 0 );
+    }
+    LOGD( "Test: storage LINEAR16 error[%3.3f] LOG8 error[%3.3f] of bound, codes[%d] buffers[%d] result[%s]\n", linearWorst, log8Worst, codeErrors, boundErrors, ( linearWorst <= 1.0f && log8Worst <= 1.0f && !codeErrors && !boundErrors ? "ok" : "failed" ) );
+  }
+
+
+  {//             
+    std::vector< Vec2 > points;
+    TestScene( points, 300, 200.0f );
+    const int half = int( points.size() ) / 4 * 2;
+    LBuffer cached( 700, Math::TWO_PI ), direct( 700, Math::TWO_PI );
+    LBufferCacheEntity entity;
+    cached.Clear( 250.0f );
+    direct.Clear( 250.0f );
+    for( int q = 0; q < int( points.size() ); q += 2 ) {
+      cached.DrawLine( ( q < half ? &entity : NULL ), points[ q ], points[ q + 1 ] );
+      direct.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+    }
+    const int different = TestCompare( cached, direct );
+    LOGD( "Test: tile bounds built after cached drawing different[%d] result[%s]\n", different, ( !different ? "ok" : "failed" ) );
+  }
+
+
+  {//BeginFrontToBack / EndFrontToBack    ,        
+    std::vector< Vec2 > points, polygon;
+    TestScene( points, 2000, 300.0f );
+    TestPolygon( polygon, Vec2( 15.0f, -5.0f ), 7, 8.0f );
+    LBuffer unordered( 3000, Math::TWO_PI ), ordered( 3000, Math::TWO_PI );
+    unordered.Clear( 400.0f );
+    ordered.Clear( 400.0f );
+    ordered.BeginFrontToBack();
+    for( int q = 0; q + 1 < int( points.size() ); q += 2 ) {
+      unordered.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+      ordered.DrawLine( NULL, points[ q ], points[ q + 1 ] );
+    }
+    unordered.DrawPolygon( NULL, &polygon[ 0 ], int( polygon.size() ) );
+    ordered.DrawPolygon( NULL, &polygon[ 0 ], int( polygon.size() ) );
+    ordered.EndFrontToBack();
+    int written = 0;
+    for( int q = 0; q < unordered.GetSize(); ++q ) {
+      written += ( unordered.GetValueByIndex( q ) < 400.0f ? 1 : 0 );
+    }
+    const int different = TestCompare( ordered, unordered );
+    LOGD( "Test: front-to-back written[%d] different[%d] result[%s]\n", written, different, ( written && !different && !ordered.IsFrontToBack() ? "ok" : "failed" ) );
+  }
+
+
+  {//DrawPolygonOccluder    ,   DrawPolygon:    ,    
+    std::vector< Vec2 > polygons[ 4 ];
+    TestPolygon( polygons[ 0 ], Vec2( 70.0f, 25.0f ), 11, 20.0f );
+    TestPolygon( polygons[ 1 ], Vec2( 3.0f, -2.0f ), 11, 40.0f );
+    for( int p = 2; p < 4; ++p ) {
+      //:     ,    
+      const Vec2 center = ( p == 2 ? Vec2( -60.0f, 40.0f ) : Vec2( -4.0f, 3.0f ) );
+      const float radius = ( p == 2 ? 30.0f : 60.0f );
+      for( int q = 0; q < 14; ++q ) {
+        const float angle = q * Math::TWO_PI / 14.0f + 0.1f;
+        polygons[ p ].push_back( center + Vec2( Math::Cos( angle ), Math::Sin( angle ) ) * ( q & 1 ? radius * 0.4f : radius ) );
+      }
+    }
+    int different = 0, written = 0;
+    for( int p = 0; p < 4; ++p ) {
+      LBuffer whole( 2000, Math::TWO_PI ), occluder( 2000, Math::TWO_PI );
+      whole.Clear( 200.0f );
+      occluder.Clear( 200.0f );
+      whole.DrawPolygon( NULL, &polygons[ p ][ 0 ], int( polygons[ p ].size() ) );
+      occluder.DrawPolygonOccluder( NULL, &polygons[ p ][ 0 ], int( polygons[ p ].size() ) );
+      for( int q = 0; q < whole.GetSize(); ++q ) {
+        written += ( whole.GetValueByIndex( q ) < 200.0f ? 1 : 0 );
+      }
+      different += TestCompare( whole, occluder );
+    }
+    LOGD( "Test: DrawPolygonOccluder written[%d] different[%d] result[%s]\n", written, different, ( written && !different ? "ok" : "failed" ) );
+  }
+
+
+  {//IsObjectInRange     :   ,      
+    const float radius = 60.0f;
+    LBuffer clipped( 3600, Math::TWO_PI );
+    clipped.Clear( radius );
+    Object objects[ 4 ];
+    objects[ 0 ].position.Set( 100.0f, 0.0f );
+    objects[ 0 ].size.Set( 30.0f, 40.0f );
+    objects[ 1 ].position.Set( 100.0f, 0.0f );
+    objects[ 1 ].size.Set( 20.0f, 0.0f );
+    objects[ 2 ].position.Set( 0.0f, 100.0f );
+    objects[ 2 ].size.Set( 0.0f, 40.0f );
+    objects[ 3 ].position.Set( 0.0f, 100.0f );
+    objects[ 3 ].size.Set( 0.0f, 40.5f );
+    int rangeErrors = 0;
+    for( int q = 0; q < 4; ++q ) {
+      rangeErrors += ( clipped.IsObjectInRange( &objects[ q ] ) != ( q == 0 || q == 3 ) ? 1 : 0 );
+    }
+
+    //     ,   -   
+    const Vec2 crossing0( -80.0f, 10.0f ), crossing1( 70.0f, 45.0f );
+    Vec2 point0( crossing0 ), point1( crossing1 );
+    float nearest;
+    int clippedMask, clipErrors = 0;
+    const bool crossingKept = LBufferClipSegment( point0, point1, radius, nearest, clippedMask );
+    clipErrors += ( !crossingKept || clippedMask != ( LBUFFER_CLIPPED_POINT0 | LBUFFER_CLIPPED_POINT1 ) ? 1 : 0 );
+    clipErrors += ( Math::Fabs( point0.Length() - radius ) > 1.0e-3f || Math::Fabs( point1.Length() - radius ) > 1.0e-3f ? 1 : 0 );
+    const Vec2 edge( crossing1 - crossing0 );
+    clipErrors += ( Math::Fabs( nearest - Math::Fabs( crossing0.x * edge.y - crossing0.y * edge.x ) / edge.Length() ) > 1.0e-3f ? 1 : 0 );
+    Vec2 outside0( 80.0f, -50.0f ), outside1( 75.0f, 50.0f );
+    clipErrors += ( LBufferClipSegment( outside0, outside1, radius, nearest, clippedMask ) ? 1 : 0 );
+
+    //   -         ( ,     )
+    const Vec2 inner0( 10.0f, 5.0f ), inner1( 90.0f, 70.0f );
+    const Vec2 segments[] = { crossing0, crossing1, outside0, outside1, Vec2( -radius, -100.0f ), Vec2( -radius, 100.0f ), inner0, inner1 };
+    for( int q = 0; q < 8; q += 2 ) {
+      clipped.DrawLine( NULL, segments[ q ], segments[ q + 1 ] );
+    }
+    int depthErrors = 0, written = 0;
+    for( int x = 0; x < clipped.GetSize(); ++x ) {
+      const float angle = float( x ) * Math::TWO_PI / float( clipped.GetSize() );
+      const Vec2 ray( Math::Cos( angle ), -Math::Sin( angle ) );
+      float expected = radius;
+      bool ambiguous = false;
+      for( int q = 0; q < 8; q += 2 ) {
+        const Vec2 start( segments[ q ] ), along( segments[ q + 1 ] - segments[ q ] );
+        const float denominator = ray.x * along.y - ray.y * along.x;
+        if( denominator == 0.0f ) {
+          continue;
+        }
+        const float distance = ( start.x * along.y - start.y * along.x ) / denominator,
+                    t = ( start.x * ray.y - start.y * ray.x ) / denominator;
+        //           
+        ambiguous = ambiguous || ( distance > 0.0f && Math::Fabs( distance - radius ) < 0.01f ) || ( distance > 0.0f && distance < radius && ( Math::Fabs( t ) < 1.0e-3f || Math::Fabs( t - 1.0f ) < 1.0e-3f ) );
+        if( distance > 0.0f && t >= 0.0f && t <= 1.0f ) {
+          expected = min( expected, distance );
+        }
+      }
+      const float value = clipped.GetValueByIndex( x );
+      written += ( value < radius ? 1 : 0 );
+      depthErrors += ( !ambiguous && Math::Fabs( value - expected ) > 1.0e-3f * expected ? 1 : 0 );
+    }
+    LOGD( "Test: IsObjectInRange and radius clip range[%d] clip[%d] written[%d] depth[%d] result[%s]\n", rangeErrors, clipErrors, written, depthErrors, ( !rangeErrors && !clipErrors && written && !depthErrors ? "ok" : "failed" ) );
+  }
+
+
+  {//GetColumnsOfPoints  ,   atan2,          0 / 2pi
+    LBuffer columns( 65536, Math::TWO_PI );
+    std::vector< Vec2 > points;
+    for( int q = 0; q < 400; ++q ) {
+      points.push_back( Vec2( TestRandom( -500.0f, 500.0f ), TestRandom( -500.0f, 500.0f ) ) );
+    }
+    //:  +x       
+    const float offsets[] = { 0.0f, 1.0e-6f, -1.0e-6f, 1.0e-3f, -1.0e-3f, 0.5f, -0.5f };
+    for( int q = 0; q < 7; ++q ) {
+      points.push_back( Vec2( 1.0f, offsets[ q ] ) );
+      points.push_back( Vec2( 300.0f, offsets[ q ] ) );
+    }
+    points.push_back( Vec2( 0.0f, 0.0f ) ); // :     
+    const int count = int( points.size() );
+    std::vector< float > result( count );
+    columns.GetColumnsOfPoints( &points[ 0 ], count, &result[ 0 ] );
+    float worst = 0.0f;
+    int outside = 0, scalarDifferent = 0;
+    for( int q = 0; q < count; ++q ) {
+      double turns = -atan2( double( points[ q ].y ), double( points[ q ].x ) ) / double( Math::TWO_PI );
+      if( turns < 0.0 ) {
+        turns += 1.0;
+      }
+      //  :  65535.99   0 
+      double error = fabs( double( result[ q ] ) - turns * double( columns.GetColumnsPerTurn() ) );
+      error = min( error, double( columns.GetColumnsPerTurn() ) - error );
+      worst = max( worst, float( error ) );
+      outside += ( result[ q ] < 0.0f || result[ q ] >= float( columns.GetSize() ) ? 1 : 0 );
+      scalarDifferent += ( Math::Fabs( result[ q ] - columns.GetColumnOfPoint( points[ q ] ) ) > LBUFFER_ANGLE_MAX_ERROR * columns.GetColumnsPerTurn() ? 1 : 0 );
+    }
+    const float bound = ( LBUFFER_ANGLE_MAX_ERROR + 1.2e-7f ) * columns.GetColumnsPerTurn(); //  float   
+    LOGD( "Test: GetColumnsOfPoints points[%d] error[%3.5f] bound[%3.5f] outside[%d] scalar[%d] result[%s]\n", count, worst, bound, outside, scalarDifferent, ( worst <= bound && !outside && !scalarDifferent ? "ok" : "failed" ) );
   }
 
 